@@ -0,0 +1,689 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <omp.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef USE_NUMA
+#include <numaif.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+
+#include "parameters.h"
+#include "graph_config.h"
+
+#include "adj_scan.h"
+
+namespace fg
+{
+
+namespace
+{
+
+/*
+ * A vertex in a scan doesn't have any state. It only requests its own
+ * adjacency list when it's activated.
+ */
+class scan_vertex: public compute_vertex
+{
+public:
+	scan_vertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+	}
+};
+
+template<class VertexType, class T>
+void copy_weights(const page_vertex &vertex, edge_type type,
+		std::vector<double> &buf)
+{
+	const VertexType &v = (const VertexType &) vertex;
+	vsize_t num = vertex.get_num_edges(type);
+	buf.resize(num);
+	safs::page_byte_array::seq_const_iterator<T> it
+		= v.template get_data_seq_it<T>(type, 0, num);
+	for (vsize_t i = 0; it.has_next(); i++)
+		buf[i] = it.next();
+}
+
+template<class VertexType>
+void copy_weights(const page_vertex &vertex, edge_type type,
+		edge_weight_t weight_type, std::vector<double> &buf)
+{
+	switch (weight_type) {
+		case edge_weight_t::INT:
+			copy_weights<VertexType, int>(vertex, type, buf);
+			break;
+		case edge_weight_t::LONG:
+			copy_weights<VertexType, long>(vertex, type, buf);
+			break;
+		case edge_weight_t::FLOAT:
+			copy_weights<VertexType, float>(vertex, type, buf);
+			break;
+		case edge_weight_t::DOUBLE:
+			copy_weights<VertexType, double>(vertex, type, buf);
+			break;
+		default:
+			buf.clear();
+	}
+}
+
+void copy_neighs(const page_vertex &vertex, edge_type type,
+		std::vector<vertex_id_t> &buf)
+{
+	vsize_t num = vertex.get_num_edges(type);
+	buf.resize(num);
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type, 0, num);
+	for (vsize_t i = 0; it.has_next(); i++)
+		buf[i] = it.next();
+}
+
+size_t get_weight_size(edge_weight_t weight_type)
+{
+	switch (weight_type) {
+		case edge_weight_t::INT:
+		case edge_weight_t::FLOAT:
+			return 4;
+		case edge_weight_t::LONG:
+		case edge_weight_t::DOUBLE:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+class scan_vertex_program: public vertex_program_impl<scan_vertex>
+{
+	adj_visitor &visitor;
+	int thread_id;
+	bool directed;
+	edge_weight_t weight_type;
+	scan_counter &counter;
+
+	// Adjacency lists in a page_vertex may span multiple pages, so we
+	// copy them to contiguous buffers before passing them to the visitor.
+	std::vector<vertex_id_t> out_buf;
+	std::vector<vertex_id_t> in_buf;
+	std::vector<double> out_wbuf;
+	std::vector<double> in_wbuf;
+public:
+	scan_vertex_program(adj_visitor &_visitor, int thread_id, bool directed,
+			edge_weight_t weight_type, scan_counter &_counter): visitor(
+				_visitor), counter(_counter) {
+		this->thread_id = thread_id;
+		this->directed = directed;
+		this->weight_type = weight_type;
+	}
+
+	void visit(const page_vertex &vertex);
+};
+
+void scan_vertex_program::visit(const page_vertex &vertex)
+{
+	adj_list adj;
+	adj.id = vertex.get_id();
+	copy_neighs(vertex, edge_type::OUT_EDGE, out_buf);
+	adj.out_neighs = out_buf.data();
+	adj.num_out = out_buf.size();
+	if (weight_type != edge_weight_t::NONE) {
+		if (directed)
+			copy_weights<page_directed_vertex>(vertex, edge_type::OUT_EDGE,
+					weight_type, out_wbuf);
+		else
+			copy_weights<page_undirected_vertex>(vertex, edge_type::OUT_EDGE,
+					weight_type, out_wbuf);
+		adj.out_weights = out_wbuf.data();
+	}
+	else
+		adj.out_weights = NULL;
+
+	if (directed) {
+		copy_neighs(vertex, edge_type::IN_EDGE, in_buf);
+		adj.in_neighs = in_buf.data();
+		adj.num_in = in_buf.size();
+		if (weight_type != edge_weight_t::NONE) {
+			copy_weights<page_directed_vertex>(vertex, edge_type::IN_EDGE,
+					weight_type, in_wbuf);
+			adj.in_weights = in_wbuf.data();
+		}
+		else
+			adj.in_weights = NULL;
+	}
+	else {
+		adj.in_neighs = adj.out_neighs;
+		adj.num_in = adj.num_out;
+		adj.in_weights = adj.out_weights;
+	}
+	size_t num_edges = directed ? adj.num_out + adj.num_in : adj.num_out;
+	counter.num_vertices++;
+	counter.num_edges += num_edges;
+	counter.num_bytes += num_edges * (sizeof(vertex_id_t)
+			+ get_weight_size(weight_type));
+	visitor.visit(adj, thread_id);
+}
+
+void scan_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	((scan_vertex_program &) prog).visit(vertex);
+}
+
+class scan_program_creater: public vertex_program_creater
+{
+	adj_visitor &visitor;
+	bool directed;
+	edge_weight_t weight_type;
+	std::vector<scan_counter> &counters;
+	mutable std::atomic<int> num_created;
+public:
+	scan_program_creater(adj_visitor &_visitor, bool directed,
+			edge_weight_t weight_type, std::vector<scan_counter> &_counters)
+			: visitor(_visitor), counters(_counters) {
+		this->directed = directed;
+		this->weight_type = weight_type;
+		num_created = 0;
+	}
+
+	vertex_program::ptr create() const {
+		int thread_id = num_created.fetch_add(1) % counters.size();
+		return vertex_program::ptr(new scan_vertex_program(visitor, thread_id,
+					directed, weight_type, counters[thread_id]));
+	}
+};
+
+class degree_visitor: public adj_visitor
+{
+	edge_type type;
+	bool directed;
+	std::vector<vsize_t> &degrees;
+public:
+	degree_visitor(edge_type type, bool directed,
+			std::vector<vsize_t> &_degrees): degrees(_degrees) {
+		this->type = type;
+		this->directed = directed;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		if (type == edge_type::IN_EDGE)
+			degrees[adj.id] = adj.num_in;
+		else if (type == edge_type::OUT_EDGE || !directed)
+			degrees[adj.id] = adj.num_out;
+		else
+			degrees[adj.id] = adj.num_in + adj.num_out;
+	}
+};
+
+/*
+ * Add the neighbors of the frontier vertices to the neighborhoods that
+ * contain them. Each thread collects the neighbors per neighborhood
+ * locally.
+ */
+class expand_visitor: public adj_visitor
+{
+	edge_type type;
+	bool directed;
+	const member_index &index;
+	// thread -> neighborhood -> neighbors
+	std::vector<std::vector<std::vector<vertex_id_t> > > &local_neighs;
+public:
+	expand_visitor(edge_type type, bool directed, const member_index &_index,
+			std::vector<std::vector<std::vector<vertex_id_t> > > &_local_neighs)
+			: index(_index), local_neighs(_local_neighs) {
+		this->type = type;
+		this->directed = directed;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		auto range = index.find(adj.id);
+		for (auto it = range.first; it != range.second; it++) {
+			std::vector<vertex_id_t> &neighs
+				= local_neighs[thread_id][it->second];
+			for_each_neigh(adj, type, directed, [&neighs](vertex_id_t u) {
+					neighs.push_back(u);
+					});
+		}
+	}
+};
+
+scan_progress progress;
+std::vector<node_traffic> traffic;
+std::function<void ()> interrupt_handler;
+std::function<void (const scan_progress &)> progress_handler;
+// The graph objects with attached caches.
+std::vector<std::pair<std::weak_ptr<FG_graph>, adj_cache::ptr> > attached_caches;
+std::mutex attach_lock;
+
+}
+
+void reset_scan_progress()
+{
+	memset(&progress, 0, sizeof(progress));
+	traffic.assign(get_num_numa_nodes(), node_traffic());
+}
+
+const scan_progress &get_scan_progress()
+{
+	return progress;
+}
+
+const std::vector<node_traffic> &get_node_traffic()
+{
+	return traffic;
+}
+
+int get_num_numa_nodes()
+{
+	return std::max(safs::params.get_num_nodes(), 1);
+}
+
+int get_thread_node(int thread_id)
+{
+	return thread_id % get_num_numa_nodes();
+}
+
+int get_vertex_node(vertex_id_t id)
+{
+	int thread_id = (id >> graph_conf.get_part_range_size_log())
+		% graph_conf.get_num_threads();
+	return get_thread_node(thread_id);
+}
+
+void place_vertex_states(void *addr, size_t num_vertices, size_t entry_size)
+{
+#ifdef USE_NUMA
+	int num_nodes = get_num_numa_nodes();
+	// A node mask of a single word covers all nodes we bind to.
+	if (num_nodes <= 1 || num_nodes > (int) (sizeof(unsigned long) * 8))
+		return;
+
+	uintptr_t page_size = sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t) addr;
+	uintptr_t end = start + num_vertices * entry_size;
+	size_t range_size = 1UL << graph_conf.get_part_range_size_log();
+	// A page shared by two vertex ranges goes to the node of the later range.
+	for (size_t vid = 0; vid < num_vertices; vid += range_size) {
+		uintptr_t range_start = (start + vid * entry_size) & ~(page_size - 1);
+		uintptr_t range_end;
+		if (vid + range_size >= num_vertices)
+			range_end = (end + page_size - 1) & ~(page_size - 1);
+		else
+			range_end = (start + (vid + range_size) * entry_size)
+				& ~(page_size - 1);
+		if (range_end <= range_start)
+			continue;
+		unsigned long mask = 1UL << get_vertex_node(vid);
+		// The pages are allocated already, so they have to be moved.
+		// A failure only costs remote memory accesses.
+		mbind((void *) range_start, range_end - range_start, MPOL_PREFERRED,
+				&mask, sizeof(mask) * 8, MPOL_MF_MOVE);
+	}
+#endif
+}
+
+void set_interrupt_handler(std::function<void ()> handler)
+{
+	interrupt_handler = handler;
+}
+
+void set_progress_handler(std::function<void (const scan_progress &)> handler)
+{
+	progress_handler = handler;
+}
+
+void check_interrupt()
+{
+	if (interrupt_handler)
+		interrupt_handler();
+}
+
+/*
+ * Copy the adjacency lists of the vertices to be cached to the locations
+ * computed from their degrees.
+ */
+class adj_cache::fill_visitor: public adj_visitor
+{
+	adj_cache &cache;
+public:
+	fill_visitor(adj_cache &_cache): cache(_cache) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		size_t idx = std::lower_bound(cache.vids.begin(), cache.vids.end(),
+				adj.id) - cache.vids.begin();
+		entry &e = cache.entries[idx];
+		e.num_out = adj.num_out;
+		e.num_in = cache.directed ? adj.num_in : 0;
+		std::copy(adj.out_neighs, adj.out_neighs + e.num_out,
+				cache.neighs.begin() + e.off);
+		std::copy(adj.in_neighs, adj.in_neighs + e.num_in,
+				cache.neighs.begin() + e.off + e.num_out);
+		if (!cache.weights.empty()) {
+			std::copy(adj.out_weights, adj.out_weights + e.num_out,
+					cache.weights.begin() + e.off);
+			std::copy(adj.in_weights, adj.in_weights + e.num_in,
+					cache.weights.begin() + e.off + e.num_out);
+		}
+	}
+};
+
+adj_cache::ptr adj_cache::create(FG_graph::ptr fg, size_t budget,
+		edge_weight_t weight_type)
+{
+	// The cache is filled from the graph itself.
+	adj_scanner::ptr scanner = adj_scanner::create(fg, weight_type,
+			adj_cache::ptr());
+	std::vector<vsize_t> degrees = scanner->get_degrees(
+			edge_type::BOTH_EDGES);
+	std::vector<vertex_id_t> order(degrees.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&degrees](vertex_id_t v1,
+				vertex_id_t v2) {
+			return degrees[v1] > degrees[v2];
+			});
+
+	adj_cache::ptr cache(new adj_cache());
+	cache->num_vertices = degrees.size();
+	cache->directed = scanner->is_directed();
+	cache->weight_type = weight_type;
+	size_t edge_size = sizeof(vertex_id_t)
+		+ (weight_type == edge_weight_t::NONE ? 0 : sizeof(double));
+	size_t size = 0;
+	for (size_t i = 0; i < order.size() && degrees[order[i]] > 0; i++) {
+		size_t vsize = degrees[order[i]] * edge_size + sizeof(vertex_id_t)
+			+ sizeof(entry);
+		if (size + vsize > budget)
+			break;
+		size += vsize;
+		cache->vids.push_back(order[i]);
+	}
+	std::sort(cache->vids.begin(), cache->vids.end());
+
+	size_t num_edges = 0;
+	cache->entries.resize(cache->vids.size());
+	for (size_t i = 0; i < cache->vids.size(); i++) {
+		cache->entries[i].off = num_edges;
+		num_edges += degrees[cache->vids[i]];
+	}
+	cache->neighs.resize(num_edges);
+	if (weight_type != edge_weight_t::NONE)
+		cache->weights.resize(num_edges);
+	fill_visitor visitor(*cache);
+	scanner->scan(cache->vids, visitor);
+	return cache;
+}
+
+void adj_cache::get(vertex_id_t vid, bool with_weights, adj_list &adj) const
+{
+	size_t idx = std::lower_bound(vids.begin(), vids.end(), vid)
+		- vids.begin();
+	const entry &e = entries[idx];
+	adj.id = vid;
+	adj.out_neighs = neighs.data() + e.off;
+	adj.num_out = e.num_out;
+	adj.out_weights = with_weights && !weights.empty()
+		? weights.data() + e.off : NULL;
+	if (directed) {
+		adj.in_neighs = adj.out_neighs + e.num_out;
+		adj.num_in = e.num_in;
+		adj.in_weights = adj.out_weights ? adj.out_weights + e.num_out : NULL;
+	}
+	else {
+		adj.in_neighs = adj.out_neighs;
+		adj.num_in = adj.num_out;
+		adj.in_weights = adj.out_weights;
+	}
+}
+
+void attach_adj_cache(FG_graph::ptr fg, adj_cache::ptr cache)
+{
+	std::lock_guard<std::mutex> lock(attach_lock);
+	// Drop the caches of the graph objects that are gone together with
+	// the old cache of this object.
+	for (size_t i = 0; i < attached_caches.size(); ) {
+		FG_graph::ptr owner = attached_caches[i].first.lock();
+		if (owner == NULL || owner == fg) {
+			attached_caches[i] = attached_caches.back();
+			attached_caches.pop_back();
+		}
+		else
+			i++;
+	}
+	if (fg && cache)
+		attached_caches.push_back(std::pair<std::weak_ptr<FG_graph>,
+				adj_cache::ptr>(fg, cache));
+}
+
+adj_cache::ptr get_adj_cache(FG_graph::ptr fg)
+{
+	std::lock_guard<std::mutex> lock(attach_lock);
+	for (size_t i = 0; i < attached_caches.size(); i++)
+		if (fg && attached_caches[i].first.lock() == fg)
+			return attached_caches[i].second;
+	return adj_cache::ptr();
+}
+
+edge_weight_t get_edge_weight_type(const std::string &attr_type)
+{
+	if (attr_type == "I")
+		return edge_weight_t::INT;
+	else if (attr_type == "L")
+		return edge_weight_t::LONG;
+	else if (attr_type == "F")
+		return edge_weight_t::FLOAT;
+	else if (attr_type == "D")
+		return edge_weight_t::DOUBLE;
+	else
+		return edge_weight_t::NONE;
+}
+
+adj_scanner::adj_scanner(FG_graph::ptr fg, edge_weight_t weight_type,
+		adj_cache::ptr cache)
+{
+	this->fg = fg;
+	this->weight_type = weight_type;
+	directed = fg->get_graph_header().is_directed_graph();
+	graph_index::ptr index = NUMA_graph_index<scan_vertex>::create(
+			fg->get_graph_header());
+	engine = fg->create_engine(index);
+	num_threads = graph_conf.get_num_threads();
+	counters.resize(num_threads);
+	reset_scan_progress();
+	if (cache && cache->get_graph_num_vertices() != get_num_vertices())
+		fprintf(stderr, "the adjacency cache isn't built on the graph\n");
+	else if (cache && (weight_type == edge_weight_t::NONE
+				|| cache->get_weight_type() == weight_type))
+		this->cache = cache;
+}
+
+void adj_scanner::end_step(size_t num_active, double time)
+{
+	progress.num_steps++;
+	progress.num_active = num_active;
+	progress.time += time;
+	for (int i = 0; i < num_threads; i++) {
+		if (cache) {
+			progress.num_cache_hits += counters[i].num_hits;
+			progress.num_cache_misses += counters[i].num_vertices
+				- counters[i].num_hits;
+			progress.cache_bytes_saved += counters[i].num_saved;
+		}
+		progress.num_vertices += counters[i].num_vertices;
+		progress.num_edges += counters[i].num_edges;
+		progress.num_bytes += counters[i].num_bytes;
+		node_traffic &node = traffic[get_thread_node(i)];
+		node.num_vertices += counters[i].num_vertices;
+		node.num_edges += counters[i].num_edges;
+		node.num_bytes += counters[i].num_bytes;
+		memset(&counters[i], 0, sizeof(counters[i]));
+	}
+	if (progress_handler)
+		progress_handler(progress);
+}
+
+void adj_scanner::request(const std::vector<vertex_id_t> &vids,
+		adj_visitor &visitor)
+{
+	if (vids.empty())
+		return;
+	engine->start(vids.data(), vids.size(), vertex_initializer::ptr(),
+			vertex_program_creater::ptr(new scan_program_creater(visitor,
+					directed, weight_type, counters)));
+	engine->wait4complete();
+}
+
+/*
+ * The cached vertices are visited after the engine finishes the other
+ * vertices, so a thread ID isn't used by two threads at the same time.
+ */
+void adj_scanner::visit_cached(const std::vector<vertex_id_t> &vids,
+		adj_visitor &visitor)
+{
+	bool with_weights = weight_type != edge_weight_t::NONE;
+	size_t edge_size = sizeof(vertex_id_t) + get_weight_size(weight_type);
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 64)
+	for (size_t i = 0; i < vids.size(); i++) {
+		int thread_id = omp_get_thread_num();
+		adj_list adj;
+		cache->get(vids[i], with_weights, adj);
+		size_t num_edges = directed ? adj.num_out + adj.num_in : adj.num_out;
+		scan_counter &counter = counters[thread_id];
+		counter.num_vertices++;
+		counter.num_edges += num_edges;
+		counter.num_bytes += num_edges * edge_size;
+		counter.num_hits++;
+		counter.num_saved += num_edges * edge_size;
+		visitor.visit(adj, thread_id);
+	}
+}
+
+void adj_scanner::scan(const std::vector<vertex_id_t> &vids,
+		adj_visitor &visitor)
+{
+	if (vids.empty())
+		return;
+	check_interrupt();
+	auto start = std::chrono::steady_clock::now();
+	if (cache) {
+		std::vector<vertex_id_t> cached;
+		std::vector<vertex_id_t> requested;
+		for (size_t i = 0; i < vids.size(); i++) {
+			if (cache->contains(vids[i]))
+				cached.push_back(vids[i]);
+			else
+				requested.push_back(vids[i]);
+		}
+		request(requested, visitor);
+		visit_cached(cached, visitor);
+	}
+	else
+		request(vids, visitor);
+	end_step(vids.size(), std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count());
+}
+
+void adj_scanner::scan_all(adj_visitor &visitor)
+{
+	check_interrupt();
+	auto start = std::chrono::steady_clock::now();
+	if (cache) {
+		if (uncached.size() + cache->get_num_cached() != get_num_vertices()) {
+			uncached.clear();
+			for (size_t i = 0; i < get_num_vertices(); i++)
+				if (!cache->contains(i))
+					uncached.push_back(i);
+		}
+		request(uncached, visitor);
+		visit_cached(cache->get_vertices(), visitor);
+	}
+	else {
+		engine->start_all(vertex_initializer::ptr(),
+				vertex_program_creater::ptr(new scan_program_creater(visitor,
+						directed, weight_type, counters)));
+		engine->wait4complete();
+	}
+	end_step(get_num_vertices(), std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count());
+}
+
+std::vector<vsize_t> adj_scanner::get_degrees(edge_type type)
+{
+	std::vector<vsize_t> degrees(get_num_vertices());
+	place_vertex_states(degrees);
+	degree_visitor visitor(type, directed, degrees);
+	scan_all(visitor);
+	return degrees;
+}
+
+std::vector<std::vector<vertex_id_t> > get_neighborhoods(
+		adj_scanner &scanner, const std::vector<vertex_id_t> &centers,
+		int radius, edge_type type)
+{
+	typedef std::vector<vertex_id_t> vset_t;
+	int num_threads = scanner.get_num_threads();
+	std::vector<vset_t> sets(centers.size());
+	std::vector<vset_t> frontiers(centers.size());
+	for (size_t i = 0; i < centers.size(); i++) {
+		sets[i].push_back(centers[i]);
+		frontiers[i].push_back(centers[i]);
+	}
+
+	for (int level = 0; level < radius; level++) {
+		member_index index(frontiers);
+		std::vector<std::vector<vset_t> > local_neighs(num_threads,
+				std::vector<vset_t>(centers.size()));
+		expand_visitor visitor(type, scanner.is_directed(), index,
+				local_neighs);
+		scanner.scan(index.get_vertices(), visitor);
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (size_t i = 0; i < centers.size(); i++) {
+			vset_t neighs;
+			for (int j = 0; j < num_threads; j++) {
+				neighs.insert(neighs.end(), local_neighs[j][i].begin(),
+						local_neighs[j][i].end());
+				vset_t().swap(local_neighs[j][i]);
+			}
+			std::sort(neighs.begin(), neighs.end());
+			neighs.erase(std::unique(neighs.begin(), neighs.end()),
+					neighs.end());
+			vset_t new_vertices;
+			std::set_difference(neighs.begin(), neighs.end(), sets[i].begin(),
+					sets[i].end(), std::back_inserter(new_vertices));
+			vset_t merged;
+			std::merge(sets[i].begin(), sets[i].end(), new_vertices.begin(),
+					new_vertices.end(), std::back_inserter(merged));
+			sets[i].swap(merged);
+			frontiers[i].swap(new_vertices);
+		}
+	}
+	return sets;
+}
+
+}
@@ -0,0 +1,469 @@
+#ifndef __ADJ_SCAN_H__
+#define __ADJ_SCAN_H__
+
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "FGlib.h"
+#include "graph_engine.h"
+
+#include "mem_vec_store.h"
+#include "mem_matrix_store.h"
+#include "dense_matrix.h"
+
+namespace fg
+{
+
+/*
+ * The adjacency list of a vertex handed to an adjacency visitor.
+ * For an undirected graph, the in-edges and the out-edges point to
+ * the same neighbor list.
+ * The weights are only available if the scanner is created with
+ * an edge weight type.
+ */
+struct adj_list
+{
+	vertex_id_t id;
+	const vertex_id_t *out_neighs;
+	vsize_t num_out;
+	const vertex_id_t *in_neighs;
+	vsize_t num_in;
+	const double *out_weights;
+	const double *in_weights;
+
+	const vertex_id_t *get_neighs(edge_type type) const {
+		return type == edge_type::IN_EDGE ? in_neighs : out_neighs;
+	}
+
+	vsize_t get_num_neighs(edge_type type) const {
+		return type == edge_type::IN_EDGE ? num_in : num_out;
+	}
+
+	const double *get_weights(edge_type type) const {
+		return type == edge_type::IN_EDGE ? in_weights : out_weights;
+	}
+};
+
+/*
+ * A visitor is invoked on the adjacency list of every vertex requested
+ * in a scan. It runs in the worker threads of the graph engine, so
+ * the implementation has to be thread-safe. `thread_id' is in
+ * [0, num_threads) and is unique among the threads of a scan, so it can
+ * be used to index per-thread state.
+ */
+class adj_visitor
+{
+public:
+	virtual ~adj_visitor() {
+	}
+	virtual void visit(const adj_list &adj, int thread_id) = 0;
+};
+
+/*
+ * The type of the edge attribute that is interpreted as edge weights.
+ */
+enum class edge_weight_t
+{
+	NONE,
+	INT,
+	LONG,
+	FLOAT,
+	DOUBLE,
+};
+
+edge_weight_t get_edge_weight_type(const std::string &attr_type);
+
+/*
+ * The progress of the scans since the last reset. It's only updated
+ * in the main thread at the end of a step.
+ */
+struct scan_progress
+{
+	// The number of steps.
+	size_t num_steps;
+	// The number of vertices requested in the last step.
+	size_t num_active;
+	// The number of adjacency lists and edges visited in all steps.
+	size_t num_vertices;
+	size_t num_edges;
+	// The bytes of the adjacency lists and edge weights visited in all steps.
+	size_t num_bytes;
+	// The runtime of all steps in seconds.
+	double time;
+	// The adjacency lists served by the adjacency cache and read through
+	// the graph engine when the cache is used, and the bytes of
+	// the adjacency lists and edge weights served by the cache.
+	size_t num_cache_hits;
+	size_t num_cache_misses;
+	size_t cache_bytes_saved;
+};
+
+/*
+ * The data visited by the worker threads on a NUMA node since the last
+ * reset. Divided by the runtime in scan_progress, it gives the bandwidth
+ * of the node.
+ */
+struct node_traffic
+{
+	size_t num_vertices;
+	size_t num_edges;
+	size_t num_bytes;
+};
+
+void reset_scan_progress();
+const scan_progress &get_scan_progress();
+const std::vector<node_traffic> &get_node_traffic();
+
+/*
+ * The interrupt handler runs in the main thread before each step of a scan
+ * and at the iteration boundaries of kernels. It cancels a kernel by
+ * throwing an exception, so a kernel has to keep its state in objects that
+ * release their memory when the exception passes through.
+ * The progress handler runs in the main thread after each step.
+ */
+void set_interrupt_handler(std::function<void ()> handler);
+void set_progress_handler(std::function<void (const scan_progress &)> handler);
+void check_interrupt();
+
+// The counters of a thread are padded to avoid false sharing.
+struct scan_counter
+{
+	size_t num_vertices;
+	size_t num_edges;
+	size_t num_bytes;
+	size_t num_hits;
+	size_t num_saved;
+	char pad[64 - 5 * sizeof(size_t)];
+};
+
+/*
+ * The graph engine binds its worker threads to the NUMA nodes round-robin
+ * and assigns vertex ranges of 2^part_range_size_log vertices to the worker
+ * threads round-robin. These give the node of a worker thread and the node
+ * whose thread processes a vertex.
+ */
+int get_num_numa_nodes();
+int get_thread_node(int thread_id);
+int get_vertex_node(vertex_id_t id);
+
+/*
+ * Move the pages of an array of per-vertex states to the NUMA nodes whose
+ * threads process the vertices, so a visitor updates the states in local
+ * memory. It does nothing on a single node or without libnuma.
+ */
+void place_vertex_states(void *addr, size_t num_vertices, size_t entry_size);
+
+template<class T>
+void place_vertex_states(std::vector<T> &states)
+{
+	place_vertex_states(states.data(), states.size(), sizeof(T));
+}
+
+class adj_scanner;
+
+/*
+ * The cache pins the adjacency lists of the vertices with the largest
+ * degrees in memory within a budget. It's meant for graphs in SAFS, where
+ * the adjacency lists of hub vertices would otherwise be read from SSDs
+ * in every iteration of a kernel. A cached vertex is visited without
+ * requesting it from the graph engine.
+ */
+class adj_cache
+{
+	struct entry
+	{
+		size_t off;
+		vsize_t num_out;
+		vsize_t num_in;
+	};
+
+	size_t num_vertices;
+	bool directed;
+	edge_weight_t weight_type;
+	// The cached vertices in the order of vertex IDs.
+	std::vector<vertex_id_t> vids;
+	std::vector<entry> entries;
+	// The out-edges of a cached vertex are followed by its in-edges in
+	// a directed graph.
+	std::vector<vertex_id_t> neighs;
+	std::vector<double> weights;
+
+	class fill_visitor;
+
+	adj_cache() {
+	}
+public:
+	typedef std::shared_ptr<adj_cache> ptr;
+
+	/*
+	 * Cache the adjacency lists of the vertices with the largest degrees
+	 * that fit in `budget' bytes. The edge weights are cached if
+	 * `weight_type' isn't NONE.
+	 */
+	static ptr create(FG_graph::ptr fg, size_t budget,
+			edge_weight_t weight_type);
+
+	size_t get_graph_num_vertices() const {
+		return num_vertices;
+	}
+
+	edge_weight_t get_weight_type() const {
+		return weight_type;
+	}
+
+	size_t get_num_cached() const {
+		return vids.size();
+	}
+
+	const std::vector<vertex_id_t> &get_vertices() const {
+		return vids;
+	}
+
+	size_t get_size() const {
+		return vids.size() * (sizeof(vertex_id_t) + sizeof(entry))
+			+ neighs.size() * sizeof(vertex_id_t)
+			+ weights.size() * sizeof(double);
+	}
+
+	bool contains(vertex_id_t vid) const {
+		return std::binary_search(vids.begin(), vids.end(), vid);
+	}
+
+	/*
+	 * Get the adjacency list of a cached vertex. The weights are only
+	 * available if `with_weights' is true.
+	 */
+	void get(vertex_id_t vid, bool with_weights, adj_list &adj) const;
+};
+
+/*
+ * Attach a cache to a graph object, so the scanners created on the object
+ * use it without passing the cache around. A cache has to be built on
+ * the same graph as the object. A null pointer detaches the cache of
+ * the object. An object is only referenced weakly, and its cache is
+ * released once the object is gone.
+ */
+void attach_adj_cache(FG_graph::ptr fg, adj_cache::ptr cache);
+adj_cache::ptr get_adj_cache(FG_graph::ptr fg);
+
+/*
+ * The scanner runs bulk-synchronous steps on a graph: each step fetches
+ * the adjacency lists of a set of vertices through the graph engine and
+ * runs a visitor on them in parallel. Because all I/O goes through
+ * the graph engine, a kernel written on top of the scanner runs on both
+ * in-memory graphs and graphs stored in SAFS, and the engine merges
+ * the I/O requests issued in the same step.
+ */
+class adj_scanner
+{
+	FG_graph::ptr fg;
+	graph_engine::ptr engine;
+	bool directed;
+	edge_weight_t weight_type;
+	int num_threads;
+	std::vector<scan_counter> counters;
+	adj_cache::ptr cache;
+	// The vertices that aren't cached. They're requested from the engine
+	// when the scanner visits all vertices.
+	std::vector<vertex_id_t> uncached;
+
+	void end_step(size_t num_active, double time);
+	void request(const std::vector<vertex_id_t> &vids, adj_visitor &visitor);
+	void visit_cached(const std::vector<vertex_id_t> &vids,
+			adj_visitor &visitor);
+
+	adj_scanner(FG_graph::ptr fg, edge_weight_t weight_type,
+			adj_cache::ptr cache);
+public:
+	typedef std::shared_ptr<adj_scanner> ptr;
+
+	/*
+	 * Create a scanner with the cache attached to the graph object.
+	 */
+	static ptr create(FG_graph::ptr fg,
+			edge_weight_t weight_type = edge_weight_t::NONE) {
+		return create(fg, weight_type, get_adj_cache(fg));
+	}
+
+	/*
+	 * Create a scanner with the given cache, which has to be built on
+	 * the same graph. The cache isn't used if it doesn't have the edge
+	 * weights the scanner needs.
+	 */
+	static ptr create(FG_graph::ptr fg, edge_weight_t weight_type,
+			adj_cache::ptr cache) {
+		return ptr(new adj_scanner(fg, weight_type, cache));
+	}
+
+	size_t get_num_vertices() const {
+		return engine->get_num_vertices();
+	}
+
+	bool is_directed() const {
+		return directed;
+	}
+
+	bool has_weights() const {
+		return weight_type != edge_weight_t::NONE;
+	}
+
+	edge_weight_t get_weight_type() const {
+		return weight_type;
+	}
+
+	int get_num_threads() const {
+		return num_threads;
+	}
+
+	/*
+	 * Run the visitor on the vertices in `vids'. A scan is a step of
+	 * a kernel, so it checks for interrupts before it starts.
+	 */
+	void scan(const std::vector<vertex_id_t> &vids, adj_visitor &visitor);
+	/*
+	 * Run the visitor on all vertices in the graph.
+	 */
+	void scan_all(adj_visitor &visitor);
+
+	/*
+	 * Get the number of edges of each vertex in the specified direction.
+	 * BOTH_EDGES gives in-degree + out-degree in a directed graph.
+	 */
+	std::vector<vsize_t> get_degrees(edge_type type);
+};
+
+/*
+ * Invoke `func' on the neighbors of a vertex in the specified direction.
+ * For BOTH_EDGES in a directed graph, it iterates over the in-edges and
+ * then the out-edges, so a neighbor connected in both directions is
+ * visited twice.
+ */
+template<class Func>
+void for_each_neigh(const adj_list &adj, edge_type type, bool directed,
+		Func func)
+{
+	if (type == edge_type::BOTH_EDGES) {
+		for (vsize_t i = 0; i < adj.num_out; i++)
+			func(adj.out_neighs[i]);
+		if (directed)
+			for (vsize_t i = 0; i < adj.num_in; i++)
+				func(adj.in_neighs[i]);
+	}
+	else {
+		const vertex_id_t *neighs = adj.get_neighs(type);
+		vsize_t num = adj.get_num_neighs(type);
+		for (vsize_t i = 0; i < num; i++)
+			func(neighs[i]);
+	}
+}
+
+/*
+ * The direction of edges used when a traversal goes backwards.
+ */
+static inline edge_type reverse_dir(edge_type type)
+{
+	if (type == edge_type::IN_EDGE)
+		return edge_type::OUT_EDGE;
+	else if (type == edge_type::OUT_EDGE)
+		return edge_type::IN_EDGE;
+	else
+		return type;
+}
+
+/*
+ * The index of the members of a collection of vertex sets. A member is
+ * a vertex and the index of a set that contains it. The members are sorted
+ * by vertex ID, so the sets that contain a vertex are found with a binary
+ * search.
+ */
+class member_index
+{
+public:
+	typedef std::pair<vertex_id_t, int> member_t;
+	typedef std::vector<member_t>::const_iterator const_iterator;
+private:
+	std::vector<member_t> members;
+public:
+	member_index(const std::vector<std::vector<vertex_id_t> > &sets) {
+		for (size_t i = 0; i < sets.size(); i++)
+			for (size_t j = 0; j < sets[i].size(); j++)
+				members.push_back(member_t(sets[i][j], i));
+		std::sort(members.begin(), members.end());
+	}
+
+	/*
+	 * Get all vertices in the sets without duplicates.
+	 */
+	std::vector<vertex_id_t> get_vertices() const {
+		std::vector<vertex_id_t> vids;
+		for (size_t i = 0; i < members.size(); i++)
+			if (vids.empty() || vids.back() != members[i].first)
+				vids.push_back(members[i].first);
+		return vids;
+	}
+
+	std::pair<const_iterator, const_iterator> find(vertex_id_t vid) const {
+		return std::equal_range(members.begin(), members.end(),
+				member_t(vid, 0), [](const member_t &m1, const member_t &m2) {
+				return m1.first < m2.first;
+				});
+	}
+};
+
+/*
+ * Get the vertices within `radius' hops from each center vertex in
+ * the specified direction. The neighborhoods grow together level by level,
+ * so a vertex shared by multiple neighborhoods is fetched once in a level.
+ * Each neighborhood is sorted and includes its center.
+ */
+std::vector<std::vector<vertex_id_t> > get_neighborhoods(
+		adj_scanner &scanner, const std::vector<vertex_id_t> &centers,
+		int radius, edge_type type);
+
+template<class T>
+fm::vector::ptr create_fm_vector(const std::vector<T> &data)
+{
+	fm::detail::mem_vec_store::ptr store = fm::detail::mem_vec_store::create(
+			data.size(), -1, fm::get_scalar_type<T>());
+	store->copy_from((const char *) data.data(), data.size() * sizeof(T));
+	return fm::vector::create(store);
+}
+
+/*
+ * Create a column-major dense matrix from the data.
+ */
+template<class T>
+fm::dense_matrix::ptr create_fm_matrix(const std::vector<T> &data,
+		size_t nrow, size_t ncol)
+{
+	assert(data.size() == nrow * ncol);
+	fm::detail::mem_matrix_store::ptr store
+		= fm::detail::mem_matrix_store::create(nrow, ncol,
+				fm::matrix_layout_t::L_COL, fm::get_scalar_type<T>(), -1);
+	memcpy(store->get_raw_arr(), data.data(), data.size() * sizeof(T));
+	return fm::dense_matrix::create(store);
+}
+
+}
+
+#endif
@@ -0,0 +1,482 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <math.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+/*
+ * The number of sources traversed in a single BFS pass. Each source
+ * occupies a bit in the per-vertex masks.
+ */
+const int SOURCES_PER_PASS = 64;
+
+/*
+ * The parameters of switching between top-down and bottom-up
+ * traversal. They are from the paper
+ * Scott Beamer, Krste Asanovic, David Patterson, Direction-Optimizing
+ * Breadth-First Search, SC'12.
+ */
+const double TD2BU_FACTOR = 14;
+const double BU2TD_FACTOR = 24;
+
+/*
+ * This is invoked on every vertex reached in a level. `bits' indicates
+ * the sources that reach the vertex for the first time in the level.
+ * It runs in parallel, but it's never invoked on the same vertex
+ * concurrently.
+ */
+class reach_handler
+{
+public:
+	virtual ~reach_handler() {
+	}
+	virtual void reach(vertex_id_t vid, uint64_t bits, int level) = 0;
+};
+
+// thread -> the vertices reached in a step
+typedef std::vector<std::vector<vertex_id_t> > touched_t;
+
+/*
+ * The thread that reaches a vertex first in the top-down step records it,
+ * so moving to the next level only goes through the reached vertices.
+ */
+class top_down_visitor: public adj_visitor
+{
+	edge_type type;
+	bool directed;
+	const uint64_t *frontier;
+	const uint64_t *visited;
+	uint64_t *next;
+	touched_t &touched;
+public:
+	top_down_visitor(edge_type type, bool directed, const uint64_t *frontier,
+			const uint64_t *visited, uint64_t *next,
+			touched_t &_touched): touched(_touched) {
+		this->type = type;
+		this->directed = directed;
+		this->frontier = frontier;
+		this->visited = visited;
+		this->next = next;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		uint64_t bits = frontier[adj.id];
+		uint64_t *next = this->next;
+		const uint64_t *visited = this->visited;
+		std::vector<vertex_id_t> &touched = this->touched[thread_id];
+		for_each_neigh(adj, type, directed,
+				[bits, next, visited, &touched](vertex_id_t u) {
+				// Reading `next' without synchronization is only a hint to
+				// avoid the atomic operation.
+				uint64_t new_bits = bits & ~visited[u] & ~next[u];
+				if (new_bits && __sync_fetch_and_or(&next[u], new_bits) == 0)
+					touched.push_back(u);
+			});
+	}
+};
+
+/*
+ * In the bottom-up step, an unvisited vertex searches its parents in
+ * the frontier and stops as soon as it's reached by all sources it
+ * hasn't been reached by.
+ */
+class bottom_up_visitor: public adj_visitor
+{
+	edge_type type;
+	bool directed;
+	uint64_t all_bits;
+	const uint64_t *frontier;
+	const uint64_t *visited;
+	uint64_t *next;
+	touched_t &touched;
+
+	uint64_t search(const vertex_id_t *neighs, vsize_t num, uint64_t missing,
+			uint64_t found) const {
+		for (vsize_t i = 0; i < num && found != missing; i++)
+			found |= frontier[neighs[i]] & missing;
+		return found;
+	}
+public:
+	bottom_up_visitor(edge_type type, bool directed, uint64_t all_bits,
+			const uint64_t *frontier, const uint64_t *visited, uint64_t *next,
+			touched_t &_touched): touched(_touched) {
+		this->type = type;
+		this->directed = directed;
+		this->all_bits = all_bits;
+		this->frontier = frontier;
+		this->visited = visited;
+		this->next = next;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		uint64_t missing = all_bits & ~visited[adj.id];
+		uint64_t found = 0;
+		// The parents of a vertex are the neighbors in the reverse direction.
+		if (type == edge_type::BOTH_EDGES) {
+			found = search(adj.out_neighs, adj.num_out, missing, found);
+			if (directed)
+				found = search(adj.in_neighs, adj.num_in, missing, found);
+		}
+		else {
+			edge_type rtype = reverse_dir(type);
+			found = search(adj.get_neighs(rtype), adj.get_num_neighs(rtype),
+					missing, found);
+		}
+		// Only the thread that processes the vertex writes to it.
+		if (found) {
+			next[adj.id] = found;
+			touched[thread_id].push_back(adj.id);
+		}
+	}
+};
+
+class bit_bfs
+{
+	adj_scanner::ptr scanner;
+	edge_type type;
+	size_t num_vertices;
+	// The number of edges traversed from a vertex in the top-down step
+	// and in the bottom-up step.
+	std::vector<vsize_t> fwd_degrees;
+	std::vector<vsize_t> bwd_degrees;
+
+	std::vector<uint64_t> visited;
+	std::vector<uint64_t> frontier;
+	std::vector<uint64_t> next;
+public:
+	bit_bfs(adj_scanner::ptr scanner, edge_type type);
+
+	const std::vector<vsize_t> &get_degrees() const {
+		return fwd_degrees;
+	}
+
+	/*
+	 * Run BFS from at most 64 sources and return the number of levels.
+	 */
+	int run(const std::vector<vertex_id_t> &sources, reach_handler &handler);
+};
+
+bit_bfs::bit_bfs(adj_scanner::ptr scanner, edge_type type)
+{
+	this->scanner = scanner;
+	if (!scanner->is_directed())
+		type = edge_type::OUT_EDGE;
+	this->type = type;
+	num_vertices = scanner->get_num_vertices();
+	fwd_degrees = scanner->get_degrees(type);
+	if (type == edge_type::BOTH_EDGES || !scanner->is_directed())
+		bwd_degrees = fwd_degrees;
+	else
+		bwd_degrees = scanner->get_degrees(reverse_dir(type));
+	visited.resize(num_vertices);
+	frontier.resize(num_vertices);
+	next.resize(num_vertices);
+	place_vertex_states(visited);
+	place_vertex_states(frontier);
+	place_vertex_states(next);
+}
+
+int bit_bfs::run(const std::vector<vertex_id_t> &sources,
+		reach_handler &handler)
+{
+	assert(sources.size() <= (size_t) SOURCES_PER_PASS);
+	uint64_t all_bits = sources.size() == SOURCES_PER_PASS
+		? std::numeric_limits<uint64_t>::max() : (1UL << sources.size()) - 1;
+	std::fill(visited.begin(), visited.end(), 0);
+	std::fill(frontier.begin(), frontier.end(), 0);
+	std::fill(next.begin(), next.end(), 0);
+
+	std::vector<vertex_id_t> active;
+	for (size_t i = 0; i < sources.size(); i++) {
+		vertex_id_t src = sources[i];
+		if (frontier[src] == 0)
+			active.push_back(src);
+		frontier[src] |= 1UL << i;
+		visited[src] |= 1UL << i;
+	}
+	for (size_t i = 0; i < active.size(); i++)
+		handler.reach(active[i], frontier[active[i]], 0);
+	std::sort(active.begin(), active.end());
+
+	// The edges of the vertices that aren't reached by all sources.
+	// It's only computed over all vertices once, and it shrinks as
+	// the vertices are reached by all sources.
+	size_t unvisited_edges = 0;
+#pragma omp parallel for reduction(+:unvisited_edges)
+	for (size_t i = 0; i < num_vertices; i++)
+		if (visited[i] != all_bits)
+			unvisited_edges += bwd_degrees[i];
+
+	int num_threads = scanner->get_num_threads();
+	bool bottom_up = false;
+	int level = 0;
+	while (!active.empty()) {
+		size_t frontier_edges = 0;
+		for (size_t i = 0; i < active.size(); i++)
+			frontier_edges += fwd_degrees[active[i]];
+
+		if (!bottom_up)
+			bottom_up = frontier_edges > unvisited_edges / TD2BU_FACTOR;
+		else
+			bottom_up = active.size() >= num_vertices / BU2TD_FACTOR;
+
+		touched_t touched(num_threads);
+		// Only the bottom-up step goes through all vertices, because it
+		// visits all unvisited vertices anyway.
+		if (bottom_up) {
+			std::vector<std::vector<vertex_id_t> > local_unvisited(num_threads);
+#pragma omp parallel for num_threads(num_threads)
+			for (size_t i = 0; i < num_vertices; i++)
+				if (visited[i] != all_bits && bwd_degrees[i] > 0)
+					local_unvisited[omp_get_thread_num()].push_back(i);
+			std::vector<vertex_id_t> unvisited;
+			for (int i = 0; i < num_threads; i++)
+				unvisited.insert(unvisited.end(), local_unvisited[i].begin(),
+						local_unvisited[i].end());
+			bottom_up_visitor visitor(type, scanner->is_directed(), all_bits,
+					frontier.data(), visited.data(), next.data(), touched);
+			scanner->scan(unvisited, visitor);
+		}
+		else {
+			top_down_visitor visitor(type, scanner->is_directed(),
+					frontier.data(), visited.data(), next.data(), touched);
+			scanner->scan(active, visitor);
+		}
+
+		// Move to the next level. Only the old frontier and the vertices
+		// reached in the step are touched. Each vertex is recorded once,
+		// so the handler isn't invoked on a vertex concurrently.
+#pragma omp parallel for num_threads(num_threads)
+		for (size_t i = 0; i < active.size(); i++)
+			frontier[active[i]] = 0;
+		active.clear();
+		for (int i = 0; i < num_threads; i++)
+			active.insert(active.end(), touched[i].begin(), touched[i].end());
+		touched_t().swap(touched);
+		std::sort(active.begin(), active.end());
+		size_t done_edges = 0;
+#pragma omp parallel for num_threads(num_threads) reduction(+:done_edges)
+		for (size_t i = 0; i < active.size(); i++) {
+			vertex_id_t vid = active[i];
+			uint64_t new_bits = next[vid] & ~visited[vid];
+			next[vid] = 0;
+			frontier[vid] = new_bits;
+			visited[vid] |= new_bits;
+			if (new_bits)
+				handler.reach(vid, new_bits, level + 1);
+			if (new_bits && visited[vid] == all_bits)
+				done_edges += bwd_degrees[vid];
+		}
+		unvisited_edges -= done_edges;
+		if (!active.empty())
+			level++;
+	}
+	return level;
+}
+
+class dist_handler: public reach_handler
+{
+	std::vector<double> &dists;
+	size_t num_vertices;
+	size_t col_off;
+public:
+	dist_handler(std::vector<double> &_dists, size_t num_vertices,
+			size_t col_off): dists(_dists) {
+		this->num_vertices = num_vertices;
+		this->col_off = col_off;
+	}
+
+	void reach(vertex_id_t vid, uint64_t bits, int level) {
+		while (bits) {
+			int i = __builtin_ctzl(bits);
+			dists[(col_off + i) * num_vertices + vid] = level;
+			bits &= bits - 1;
+		}
+	}
+};
+
+class closeness_handler: public reach_handler
+{
+	std::vector<double> &sums;
+	bool harmonic;
+public:
+	closeness_handler(std::vector<double> &_sums, bool harmonic): sums(_sums) {
+		this->harmonic = harmonic;
+	}
+
+	void reach(vertex_id_t vid, uint64_t bits, int level) {
+		if (level == 0)
+			return;
+		int num = __builtin_popcountl(bits);
+		if (harmonic)
+			sums[vid] += ((double) num) / level;
+		else
+			sums[vid] += ((double) num) * level;
+	}
+};
+
+/*
+ * It records the eccentricity of each source and a vertex at the last
+ * level.
+ */
+class sweep_handler: public reach_handler
+{
+	vertex_id_t farthest[SOURCES_PER_PASS];
+	int eccentricity[SOURCES_PER_PASS];
+public:
+	sweep_handler() {
+		for (int i = 0; i < SOURCES_PER_PASS; i++) {
+			farthest[i] = INVALID_VERTEX_ID;
+			eccentricity[i] = 0;
+		}
+	}
+
+	void reach(vertex_id_t vid, uint64_t bits, int level) {
+		while (bits) {
+			int i = __builtin_ctzl(bits);
+			// All vertices at the same level are equally good.
+			if (level >= eccentricity[i]) {
+				__atomic_store_n(&eccentricity[i], level, __ATOMIC_RELAXED);
+				__atomic_store_n(&farthest[i], vid, __ATOMIC_RELAXED);
+			}
+			bits &= bits - 1;
+		}
+	}
+
+	vertex_id_t get_farthest(int i) const {
+		return farthest[i];
+	}
+};
+
+std::vector<vertex_id_t> sample_vertices(const std::vector<vsize_t> &degrees,
+		size_t num_samples, std::mt19937 &gen)
+{
+	std::vector<vertex_id_t> candidates;
+	for (size_t i = 0; i < degrees.size(); i++)
+		if (degrees[i] > 0)
+			candidates.push_back(i);
+	if (candidates.empty())
+		return candidates;
+	if (num_samples >= candidates.size())
+		return candidates;
+
+	// Partial Fisher-Yates shuffle.
+	for (size_t i = 0; i < num_samples; i++) {
+		std::uniform_int_distribution<size_t> dist(i, candidates.size() - 1);
+		std::swap(candidates[i], candidates[dist(gen)]);
+	}
+	candidates.resize(num_samples);
+	return candidates;
+}
+
+}
+
+fm::dense_matrix::ptr compute_bfs_dists(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type type)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	size_t num_vertices = scanner->get_num_vertices();
+	bit_bfs bfs(scanner, type);
+	std::vector<double> dists(num_vertices * sources.size(),
+			std::numeric_limits<double>::infinity());
+	for (size_t off = 0; off < sources.size(); off += SOURCES_PER_PASS) {
+		size_t end = std::min(off + SOURCES_PER_PASS, sources.size());
+		std::vector<vertex_id_t> pass(sources.begin() + off,
+				sources.begin() + end);
+		dist_handler handler(dists, num_vertices, off);
+		bfs.run(pass, handler);
+	}
+	return create_fm_matrix(dists, num_vertices, sources.size());
+}
+
+fm::vector::ptr estimate_closeness(FG_graph::ptr fg, size_t num_samples,
+		edge_type type, bool harmonic, unsigned seed)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	size_t num_vertices = scanner->get_num_vertices();
+	// BFS from a sample gives the distances from the sample to a vertex,
+	// so we traverse in the reverse direction to get the distances from
+	// a vertex to the samples.
+	bit_bfs bfs(scanner, reverse_dir(type));
+	std::mt19937 gen(seed);
+	std::vector<vertex_id_t> samples = sample_vertices(bfs.get_degrees(),
+			num_samples, gen);
+	std::vector<double> sums(num_vertices);
+	for (size_t off = 0; off < samples.size(); off += SOURCES_PER_PASS) {
+		size_t end = std::min(off + SOURCES_PER_PASS, samples.size());
+		std::vector<vertex_id_t> pass(samples.begin() + off,
+				samples.begin() + end);
+		closeness_handler handler(sums, harmonic);
+		bfs.run(pass, handler);
+	}
+
+	// Scale the sums from the samples to all vertices. This is the estimator
+	// in D. Eppstein and J. Wang, Fast approximation of centrality, SODA'01.
+	double scale = samples.empty() ? 0 : ((double) num_vertices) / samples.size();
+#pragma omp parallel for
+	for (size_t i = 0; i < num_vertices; i++) {
+		if (harmonic)
+			sums[i] *= scale;
+		else
+			sums[i] = sums[i] > 0 ? 1 / (sums[i] * scale) : 0;
+	}
+	return create_fm_vector(sums);
+}
+
+int estimate_diameter_sweeps(FG_graph::ptr fg, int num_sweeps,
+		edge_type type, unsigned seed)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	bit_bfs bfs(scanner, type);
+	std::mt19937 gen(seed);
+	std::vector<vertex_id_t> starts = sample_vertices(bfs.get_degrees(),
+			num_sweeps, gen);
+	int diameter = 0;
+	for (size_t off = 0; off < starts.size(); off += SOURCES_PER_PASS) {
+		size_t end = std::min(off + SOURCES_PER_PASS, starts.size());
+		std::vector<vertex_id_t> pass(starts.begin() + off,
+				starts.begin() + end);
+		// The first sweep of all double sweeps in the pass.
+		sweep_handler handler1;
+		diameter = std::max(diameter, bfs.run(pass, handler1));
+		// The second sweep starts from the farthest vertices found in
+		// the first sweep.
+		for (size_t i = 0; i < pass.size(); i++)
+			if (handler1.get_farthest(i) != INVALID_VERTEX_ID)
+				pass[i] = handler1.get_farthest(i);
+		sweep_handler handler2;
+		diameter = std::max(diameter, bfs.run(pass, handler2));
+	}
+	return diameter;
+}
+
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+namespace fg
+{
+
+namespace
+{
+
+const char CHECKPOINT_MAGIC[8] = {'F', 'G', 'R', 'C', 'K', 'P', 'T', '1'};
+
+std::string ckpt_file;
+double ckpt_interval;
+checkpoint::ptr resume_ckpt;
+
+bool write_string(FILE *f, const std::string &str)
+{
+	size_t len = str.size();
+	return fwrite(&len, sizeof(len), 1, f) == 1
+		&& fwrite(str.data(), 1, len, f) == len;
+}
+
+bool read_string(FILE *f, std::string &str)
+{
+	size_t len;
+	if (fread(&len, sizeof(len), 1, f) != 1)
+		return false;
+	str.resize(len);
+	return fread(&str[0], 1, len, f) == len;
+}
+
+}
+
+checkpoint::ptr checkpoint::create(const std::string &kernel, FG_graph::ptr fg)
+{
+	checkpoint::ptr ckpt(new checkpoint());
+	const graph_header &header = fg->get_graph_header();
+	ckpt->kernel = kernel;
+	ckpt->num_vertices = header.get_num_vertices();
+	ckpt->num_edges = header.get_num_edges();
+	ckpt->directed = header.is_directed_graph();
+	return ckpt;
+}
+
+bool checkpoint::is_for(const std::string &kernel, FG_graph::ptr fg) const
+{
+	const graph_header &header = fg->get_graph_header();
+	return this->kernel == kernel
+		&& num_vertices == header.get_num_vertices()
+		&& num_edges == header.get_num_edges()
+		&& directed == header.is_directed_graph();
+}
+
+bool checkpoint::save(const std::string &file) const
+{
+	std::string tmp_file = file + ".tmp";
+	FILE *f = fopen(tmp_file.c_str(), "w");
+	if (f == NULL) {
+		fprintf(stderr, "can't write checkpoint %s: %s\n", tmp_file.c_str(),
+				strerror(errno));
+		return false;
+	}
+	size_t num_arrays = arrays.size();
+	bool success = fwrite(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC), 1, f) == 1
+		&& write_string(f, kernel)
+		&& fwrite(&num_vertices, sizeof(num_vertices), 1, f) == 1
+		&& fwrite(&num_edges, sizeof(num_edges), 1, f) == 1
+		&& fwrite(&directed, sizeof(directed), 1, f) == 1
+		&& fwrite(&num_arrays, sizeof(num_arrays), 1, f) == 1;
+	for (auto it = arrays.begin(); success && it != arrays.end(); it++) {
+		size_t size = it->second.size();
+		success = write_string(f, it->first)
+			&& fwrite(&size, sizeof(size), 1, f) == 1
+			&& fwrite(it->second.data(), 1, size, f) == size;
+	}
+	// The data has to reach the disk before the rename to survive a crash.
+	success = success && fflush(f) == 0 && fsync(fileno(f)) == 0;
+	success = fclose(f) == 0 && success;
+	if (success && rename(tmp_file.c_str(), file.c_str()) < 0)
+		success = false;
+	if (!success) {
+		fprintf(stderr, "can't write checkpoint %s\n", file.c_str());
+		unlink(tmp_file.c_str());
+	}
+	return success;
+}
+
+checkpoint::ptr checkpoint::load(const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	if (f == NULL) {
+		fprintf(stderr, "can't open checkpoint %s: %s\n", file.c_str(),
+				strerror(errno));
+		return checkpoint::ptr();
+	}
+	checkpoint::ptr ckpt(new checkpoint());
+	char magic[sizeof(CHECKPOINT_MAGIC)];
+	size_t num_arrays = 0;
+	bool success = fread(magic, sizeof(magic), 1, f) == 1
+		&& memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0
+		&& read_string(f, ckpt->kernel)
+		&& fread(&ckpt->num_vertices, sizeof(ckpt->num_vertices), 1, f) == 1
+		&& fread(&ckpt->num_edges, sizeof(ckpt->num_edges), 1, f) == 1
+		&& fread(&ckpt->directed, sizeof(ckpt->directed), 1, f) == 1
+		&& fread(&num_arrays, sizeof(num_arrays), 1, f) == 1;
+	for (size_t i = 0; success && i < num_arrays; i++) {
+		std::string name;
+		size_t size;
+		success = read_string(f, name) && fread(&size, sizeof(size), 1, f) == 1;
+		if (success) {
+			std::vector<char> &arr = ckpt->arrays[name];
+			arr.resize(size);
+			success = fread(arr.data(), 1, size, f) == size;
+		}
+	}
+	fclose(f);
+	if (!success) {
+		fprintf(stderr, "%s isn't a checkpoint\n", file.c_str());
+		return checkpoint::ptr();
+	}
+	return ckpt;
+}
+
+bool checkpointer::is_due() const
+{
+	double elapsed = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - last).count();
+	return elapsed >= interval && (!pending.valid()
+			|| pending.wait_for(std::chrono::seconds(0))
+			== std::future_status::ready);
+}
+
+void checkpointer::save(checkpoint::ptr ckpt)
+{
+	if (pending.valid())
+		pending.get();
+	std::string file = this->file;
+	pending = std::async(std::launch::async, [ckpt, file]() {
+			return ckpt->save(file);
+			});
+	last = std::chrono::steady_clock::now();
+}
+
+void checkpointer::finish()
+{
+	if (pending.valid())
+		pending.get();
+	unlink(file.c_str());
+}
+
+void set_checkpoint_options(const std::string &file, double interval)
+{
+	ckpt_file = file;
+	ckpt_interval = interval;
+}
+
+checkpointer::ptr create_checkpointer()
+{
+	if (ckpt_file.empty())
+		return checkpointer::ptr();
+	return checkpointer::ptr(new checkpointer(ckpt_file, ckpt_interval));
+}
+
+void set_resume_checkpoint(checkpoint::ptr ckpt)
+{
+	resume_ckpt = ckpt;
+}
+
+checkpoint::ptr take_resume_checkpoint(const std::string &kernel,
+		FG_graph::ptr fg)
+{
+	if (resume_ckpt == NULL || !resume_ckpt->is_for(kernel, fg))
+		return checkpoint::ptr();
+	checkpoint::ptr ckpt = resume_ckpt;
+	resume_ckpt = NULL;
+	return ckpt;
+}
+
+}
@@ -0,0 +1,170 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FGlib.h"
+
+namespace fg
+{
+
+/*
+ * A checkpoint keeps the state of a kernel as named arrays. It records
+ * the kernel and the size of the graph, so a run is only resumed on
+ * the same graph.
+ */
+class checkpoint
+{
+	std::string kernel;
+	size_t num_vertices;
+	size_t num_edges;
+	bool directed;
+	std::map<std::string, std::vector<char> > arrays;
+
+	checkpoint() {
+		num_vertices = 0;
+		num_edges = 0;
+		directed = false;
+	}
+public:
+	typedef std::shared_ptr<checkpoint> ptr;
+
+	static ptr create(const std::string &kernel, FG_graph::ptr fg);
+	/*
+	 * Load a checkpoint. It returns NULL if the file isn't a checkpoint.
+	 */
+	static ptr load(const std::string &file);
+
+	const std::string &get_kernel() const {
+		return kernel;
+	}
+
+	bool is_for(const std::string &kernel, FG_graph::ptr fg) const;
+
+	/*
+	 * Write the checkpoint to a new file and rename it to `file', so
+	 * a crash during the write doesn't destroy the previous checkpoint.
+	 */
+	bool save(const std::string &file) const;
+
+	template<class T>
+	void put(const std::string &name, const T *data, size_t num) {
+		std::vector<char> &arr = arrays[name];
+		arr.resize(num * sizeof(T));
+		memcpy(arr.data(), data, arr.size());
+	}
+
+	template<class T>
+	void put(const std::string &name, const std::vector<T> &data) {
+		put(name, data.data(), data.size());
+	}
+
+	template<class T>
+	void put_value(const std::string &name, T value) {
+		put(name, &value, 1);
+	}
+
+	template<class T>
+	bool get(const std::string &name, std::vector<T> &data) const {
+		auto it = arrays.find(name);
+		if (it == arrays.end() || it->second.size() % sizeof(T) != 0)
+			return false;
+		data.resize(it->second.size() / sizeof(T));
+		memcpy(data.data(), it->second.data(), it->second.size());
+		return true;
+	}
+
+	template<class T>
+	T get_value(const std::string &name) const {
+		std::vector<T> data;
+		return get(name, data) && data.size() == 1 ? data[0] : T();
+	}
+};
+
+/*
+ * The checkpointer of a kernel run saves checkpoints in the background,
+ * so the kernel only pays for copying its state. A checkpoint is skipped
+ * if the previous one is still being written.
+ */
+class checkpointer
+{
+	std::string file;
+	double interval;
+	std::chrono::steady_clock::time_point last;
+	std::future<bool> pending;
+public:
+	typedef std::shared_ptr<checkpointer> ptr;
+
+	checkpointer(const std::string &file, double interval) {
+		this->file = file;
+		this->interval = interval;
+		last = std::chrono::steady_clock::now();
+	}
+
+	~checkpointer() {
+		if (pending.valid())
+			pending.wait();
+	}
+
+	/*
+	 * Whether the kernel should take a checkpoint now.
+	 */
+	bool is_due() const;
+	void save(checkpoint::ptr ckpt);
+	/*
+	 * The kernel has completed, so its checkpoint is removed.
+	 */
+	void finish();
+};
+
+/*
+ * Checkpoint the kernels that support it every `interval' seconds to
+ * `file'. An empty file name turns it off.
+ */
+void set_checkpoint_options(const std::string &file, double interval);
+
+/*
+ * Get the checkpointer of a kernel run. It's NULL if checkpointing is off.
+ */
+checkpointer::ptr create_checkpointer();
+
+/*
+ * The checkpoint the next run of its kernel resumes from.
+ */
+void set_resume_checkpoint(checkpoint::ptr ckpt);
+
+/*
+ * Get the checkpoint to resume a kernel from if it's for the kernel and
+ * the graph. It's only used once.
+ */
+checkpoint::ptr take_resume_checkpoint(const std::string &kernel,
+		FG_graph::ptr fg);
+
+}
+
+#endif
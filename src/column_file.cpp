@@ -0,0 +1,204 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include <algorithm>
+
+#include "graph_config.h"
+#include "mem_vec_store.h"
+
+#include "column_file.h"
+
+namespace fg
+{
+
+namespace
+{
+
+const char COLUMN_MAGIC[8] = {'F', 'G', 'R', 'C', 'O', 'L', '0', '1'};
+
+// The values a thread writes with a pwrite.
+const size_t WRITE_SIZE = 16 * 1024 * 1024;
+
+bool pwrite_all(int fd, const char *buf, size_t size, off_t off)
+{
+	while (size > 0) {
+		ssize_t ret = pwrite(fd, buf, size, off);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+		buf += ret;
+		size -= ret;
+		off += ret;
+	}
+	return true;
+}
+
+}
+
+column_writer::column_writer(const std::string &file, size_t entry_size,
+		size_t length)
+{
+	this->fd = -1;
+	this->file = file;
+	this->tmp_file = file + ".tmp";
+	this->entry_size = entry_size;
+	this->length = length;
+	this->failed = false;
+}
+
+column_writer::ptr column_writer::create(const std::string &file,
+		const std::string &type, size_t entry_size, size_t length)
+{
+	column_writer::ptr writer(new column_writer(file, entry_size, length));
+	writer->fd = open(writer->tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+			0644);
+	if (writer->fd < 0) {
+		fprintf(stderr, "can't create %s: %s\n", writer->tmp_file.c_str(),
+				strerror(errno));
+		return column_writer::ptr();
+	}
+
+	column_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, COLUMN_MAGIC, sizeof(header.magic));
+	strncpy(header.type, type.c_str(), sizeof(header.type) - 1);
+	header.entry_size = entry_size;
+	header.length = length;
+	header.data_off = sizeof(header);
+	// Allocate the file first, so the threads write to their own parts.
+	if (ftruncate(writer->fd, sizeof(header) + entry_size * length) < 0
+			|| !pwrite_all(writer->fd, (const char *) &header, sizeof(header),
+				0)) {
+		fprintf(stderr, "can't write %s: %s\n", writer->tmp_file.c_str(),
+				strerror(errno));
+		return column_writer::ptr();
+	}
+	return writer;
+}
+
+column_writer::~column_writer()
+{
+	// The writer isn't closed, so the column file is incomplete.
+	if (fd >= 0) {
+		::close(fd);
+		unlink(tmp_file.c_str());
+	}
+}
+
+bool column_writer::write(size_t off, const void *data, size_t num)
+{
+	if (off + num > length) {
+		fprintf(stderr, "write values [%ld, %ld) out of a column of %ld\n",
+				off, off + num, length);
+		failed = true;
+		return false;
+	}
+	if (!pwrite_all(fd, (const char *) data, num * entry_size,
+				sizeof(column_header) + off * entry_size)) {
+		fprintf(stderr, "can't write %s: %s\n", tmp_file.c_str(),
+				strerror(errno));
+		failed = true;
+		return false;
+	}
+	return true;
+}
+
+bool column_writer::close()
+{
+	// The data has to reach the disk before the rename, so a crash can't
+	// leave a complete column file with incomplete data.
+	int ret = failed ? 0 : fsync(fd);
+	if (::close(fd) < 0)
+		ret = -1;
+	fd = -1;
+	if (failed || ret < 0 || rename(tmp_file.c_str(), file.c_str()) < 0) {
+		fprintf(stderr, "can't write %s\n", file.c_str());
+		unlink(tmp_file.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool write_column(const std::string &file, const std::string &type,
+		size_t entry_size, const void *data, size_t length)
+{
+	column_writer::ptr writer = column_writer::create(file, type, entry_size,
+			length);
+	if (writer == NULL)
+		return false;
+	size_t write_len = std::max(WRITE_SIZE / entry_size, 1UL);
+	size_t num_writes = (length + write_len - 1) / write_len;
+	bool success = true;
+#pragma omp parallel for num_threads(graph_conf.get_num_threads()) \
+	schedule(dynamic)
+	for (size_t i = 0; i < num_writes; i++) {
+		size_t off = i * write_len;
+		size_t num = std::min(write_len, length - off);
+		if (!writer->write(off, (const char *) data + off * entry_size, num))
+			success = false;
+	}
+	return writer->close() && success;
+}
+
+bool write_column(const std::string &file, fm::vector::ptr vec)
+{
+	const fm::detail::mem_vec_store *store
+		= dynamic_cast<const fm::detail::mem_vec_store *>(&vec->get_data());
+	if (store == NULL) {
+		fprintf(stderr, "the vector isn't in memory\n");
+		return false;
+	}
+	std::string type;
+	size_t entry_size;
+	if (vec->get_type() == fm::get_scalar_type<int32_t>()) {
+		type = get_column_type<int32_t>();
+		entry_size = sizeof(int32_t);
+	}
+	else if (vec->get_type() == fm::get_scalar_type<int64_t>()) {
+		type = get_column_type<int64_t>();
+		entry_size = sizeof(int64_t);
+	}
+	else if (vec->get_type() == fm::get_scalar_type<uint32_t>()) {
+		type = get_column_type<uint32_t>();
+		entry_size = sizeof(uint32_t);
+	}
+	else if (vec->get_type() == fm::get_scalar_type<float>()) {
+		type = get_column_type<float>();
+		entry_size = sizeof(float);
+	}
+	else if (vec->get_type() == fm::get_scalar_type<double>()) {
+		type = get_column_type<double>();
+		entry_size = sizeof(double);
+	}
+	else {
+		fprintf(stderr, "can't write the vector type to a column file\n");
+		return false;
+	}
+	return write_column(file, type, entry_size, store->get_raw_arr(),
+			vec->get_length());
+}
+
+}
@@ -0,0 +1,140 @@
+#ifndef __COLUMN_FILE_H__
+#define __COLUMN_FILE_H__
+
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FGlib.h"
+
+namespace fg
+{
+
+/*
+ * A column file stores a value for each vertex. It has a 64-byte header
+ * followed by the values in the order of vertex IDs, so the whole file
+ * can be mapped to memory and the values accessed as an array.
+ */
+struct column_header
+{
+	// "FGRCOL01"
+	char magic[8];
+	// The type of the values: "I", "L", "F", "D" for 32-bit and 64-bit
+	// integers and floating points, or "U" for 32-bit unsigned integers.
+	char type[8];
+	uint64_t entry_size;
+	uint64_t length;
+	// The offset of the values in the file.
+	uint64_t data_off;
+	char pad[24];
+};
+
+template<class T>
+std::string get_column_type();
+
+template<>
+inline std::string get_column_type<int32_t>()
+{
+	return "I";
+}
+
+template<>
+inline std::string get_column_type<int64_t>()
+{
+	return "L";
+}
+
+template<>
+inline std::string get_column_type<uint32_t>()
+{
+	return "U";
+}
+
+template<>
+inline std::string get_column_type<float>()
+{
+	return "F";
+}
+
+template<>
+inline std::string get_column_type<double>()
+{
+	return "D";
+}
+
+/*
+ * The writer creates a column file of a given length, and threads write
+ * disjoint ranges of the values to it with pwrite at the same time.
+ * The values are written to a temporary file, which replaces the column
+ * file when the writer is closed.
+ */
+class column_writer
+{
+	int fd;
+	std::string file;
+	std::string tmp_file;
+	size_t entry_size;
+	size_t length;
+	bool failed;
+
+	column_writer(const std::string &file, size_t entry_size, size_t length);
+public:
+	typedef std::shared_ptr<column_writer> ptr;
+
+	/*
+	 * It returns NULL if the file can't be created.
+	 */
+	static ptr create(const std::string &file, const std::string &type,
+			size_t entry_size, size_t length);
+
+	~column_writer();
+
+	/*
+	 * Write `num' values from the `off'th value.
+	 */
+	bool write(size_t off, const void *data, size_t num);
+	bool close();
+};
+
+/*
+ * Write the values to a column file. The threads write parts of the values
+ * in parallel.
+ */
+bool write_column(const std::string &file, const std::string &type,
+		size_t entry_size, const void *data, size_t length);
+
+template<class T>
+bool write_column(const std::string &file, const std::vector<T> &data)
+{
+	return write_column(file, get_column_type<T>(), sizeof(T), data.data(),
+			data.size());
+}
+
+/*
+ * Write a vector in memory to a column file without copying it.
+ */
+bool write_column(const std::string &file, fm::vector::ptr vec);
+
+}
+
+#endif
@@ -0,0 +1,704 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+void atomic_add(double *addr, double val)
+{
+	union {
+		double d;
+		uint64_t u;
+	} old_val, new_val;
+	old_val.d = *addr;
+	while (true) {
+		new_val.d = old_val.d + val;
+		uint64_t prev = __sync_val_compare_and_swap((uint64_t *) addr,
+				old_val.u, new_val.u);
+		if (prev == old_val.u)
+			return;
+		old_val.u = prev;
+	}
+}
+
+const vertex_id_t EMPTY = INVALID_VERTEX_ID;
+
+/*
+ * Accumulate the edge weights from a vertex to each community.
+ * It's an open-addressing hash table that is reused for all vertices
+ * processed by a thread, so its size depends on the largest degree instead
+ * of the number of communities.
+ */
+class comm_accumulator
+{
+	std::vector<vertex_id_t> keys;
+	std::vector<double> vals;
+	std::vector<size_t> used;
+	size_t mask;
+
+	static size_t hash(vertex_id_t comm) {
+		return (comm * 0x9E3779B97F4A7C15ULL) >> 32;
+	}
+
+	void grow() {
+		std::vector<vertex_id_t> old_keys;
+		std::vector<double> old_vals;
+		old_keys.swap(keys);
+		old_vals.swap(vals);
+		keys.resize(old_keys.size() * 2, EMPTY);
+		vals.resize(old_vals.size() * 2);
+		mask = keys.size() - 1;
+		used.clear();
+		for (size_t i = 0; i < old_keys.size(); i++)
+			if (old_keys[i] != EMPTY)
+				add(old_keys[i], old_vals[i]);
+	}
+public:
+	comm_accumulator(): keys(64, EMPTY), vals(64) {
+		mask = keys.size() - 1;
+	}
+
+	void add(vertex_id_t comm, double weight) {
+		// Keep the load factor below 1/2.
+		if (used.size() * 2 >= keys.size())
+			grow();
+		size_t idx = hash(comm) & mask;
+		while (keys[idx] != EMPTY && keys[idx] != comm)
+			idx = (idx + 1) & mask;
+		if (keys[idx] == EMPTY) {
+			keys[idx] = comm;
+			used.push_back(idx);
+		}
+		vals[idx] += weight;
+	}
+
+	size_t get_num_comms() const {
+		return used.size();
+	}
+
+	vertex_id_t get_comm(size_t i) const {
+		return keys[used[i]];
+	}
+
+	double get_weight(size_t i) const {
+		return vals[used[i]];
+	}
+
+	double get_weight(vertex_id_t comm) const {
+		size_t idx = hash(comm) & mask;
+		while (keys[idx] != EMPTY) {
+			if (keys[idx] == comm)
+				return vals[idx];
+			idx = (idx + 1) & mask;
+		}
+		return 0;
+	}
+
+	void clear() {
+		for (size_t i = 0; i < used.size(); i++) {
+			keys[used[i]] = EMPTY;
+			vals[used[i]] = 0;
+		}
+		used.clear();
+	}
+};
+
+/*
+ * The edges of a vertex with the direction of edges ignored.
+ * An edge without a weight has the weight of 1.
+ */
+template<class Func>
+void for_each_edge(const adj_list &adj, bool directed, Func func)
+{
+	for (vsize_t i = 0; i < adj.num_out; i++)
+		func(adj.out_neighs[i], adj.out_weights ? adj.out_weights[i] : 1);
+	if (directed)
+		for (vsize_t i = 0; i < adj.num_in; i++)
+			func(adj.in_neighs[i], adj.in_weights ? adj.in_weights[i] : 1);
+}
+
+/*
+ * Mark the neighbors of a vertex that changes its community, so they're
+ * processed in the next iteration.
+ */
+void activate_neighs(const adj_list &adj, bool directed, char *active)
+{
+	for_each_edge(adj, directed, [active](vertex_id_t u, double w) {
+			active[u] = 1;
+			});
+}
+
+std::vector<vertex_id_t> get_active(std::vector<char> &active)
+{
+	std::vector<vertex_id_t> vids;
+	for (size_t i = 0; i < active.size(); i++)
+		if (active[i]) {
+			vids.push_back(i);
+			active[i] = 0;
+		}
+	return vids;
+}
+
+class lpa_visitor: public adj_visitor
+{
+	bool directed;
+	vertex_id_t *labels;
+	char *next_active;
+	std::vector<comm_accumulator> accs;
+	std::vector<size_t> num_changed;
+	std::vector<std::default_random_engine> gens;
+public:
+	lpa_visitor(bool directed, vertex_id_t *labels, char *next_active,
+			int num_threads, unsigned seed): accs(num_threads), num_changed(
+				num_threads) {
+		this->directed = directed;
+		this->labels = labels;
+		this->next_active = next_active;
+		for (int i = 0; i < num_threads; i++)
+			gens.push_back(std::default_random_engine(seed + i));
+	}
+
+	size_t get_num_changed() {
+		size_t sum = 0;
+		for (size_t i = 0; i < num_changed.size(); i++) {
+			sum += num_changed[i];
+			num_changed[i] = 0;
+		}
+		return sum;
+	}
+
+	void visit(const adj_list &adj, int thread_id);
+};
+
+/*
+ * A vertex takes the label with the largest total edge weight among its
+ * neighbors. It keeps its own label if that's one of the best labels;
+ * otherwise, ties are broken randomly. Labels are updated in place, so
+ * a vertex may see the new labels of its neighbors in the same iteration.
+ */
+void lpa_visitor::visit(const adj_list &adj, int thread_id)
+{
+	comm_accumulator &acc = accs[thread_id];
+	const vertex_id_t *labels = this->labels;
+	vertex_id_t id = adj.id;
+	for_each_edge(adj, directed, [&acc, labels, id](vertex_id_t u, double w) {
+			if (u != id)
+				acc.add(labels[u], w);
+			});
+	if (acc.get_num_comms() == 0)
+		return;
+
+	vertex_id_t curr = labels[id];
+	double max_weight = 0;
+	for (size_t i = 0; i < acc.get_num_comms(); i++)
+		max_weight = std::max(max_weight, acc.get_weight(i));
+	vertex_id_t best = curr;
+	if (acc.get_weight(curr) < max_weight) {
+		// Pick one of the best labels uniformly with reservoir sampling.
+		size_t num_best = 0;
+		for (size_t i = 0; i < acc.get_num_comms(); i++) {
+			if (acc.get_weight(i) < max_weight)
+				continue;
+			num_best++;
+			std::uniform_int_distribution<size_t> dist(0, num_best - 1);
+			if (dist(gens[thread_id]) == 0)
+				best = acc.get_comm(i);
+		}
+	}
+	acc.clear();
+	if (best != curr) {
+		this->labels[id] = best;
+		num_changed[thread_id]++;
+		activate_neighs(adj, directed, next_active);
+	}
+}
+
+/*
+ * The weighted degree of each vertex with the direction of edges ignored.
+ */
+class wdegree_visitor: public adj_visitor
+{
+	bool directed;
+	std::vector<double> &degrees;
+public:
+	wdegree_visitor(bool directed, std::vector<double> &_degrees): degrees(
+			_degrees) {
+		this->directed = directed;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		double sum = 0;
+		for_each_edge(adj, directed, [&sum](vertex_id_t u, double w) {
+				sum += w;
+				});
+		degrees[adj.id] = sum;
+	}
+};
+
+/*
+ * Sum the weights of the edges inside the communities.
+ */
+class internal_weight_visitor: public adj_visitor
+{
+	bool directed;
+	const vertex_id_t *comms;
+	std::vector<double> sums;
+public:
+	internal_weight_visitor(bool directed, const vertex_id_t *comms,
+			int num_threads): sums(num_threads) {
+		this->directed = directed;
+		this->comms = comms;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		const vertex_id_t *comms = this->comms;
+		vertex_id_t comm = comms[adj.id];
+		double sum = 0;
+		for_each_edge(adj, directed, [comms, comm, &sum](vertex_id_t u,
+					double w) {
+				if (comms[u] == comm)
+					sum += w;
+				});
+		sums[thread_id] += sum;
+	}
+
+	double get_sum() const {
+		double sum = 0;
+		for (size_t i = 0; i < sums.size(); i++)
+			sum += sums[i];
+		return sum;
+	}
+};
+
+/*
+ * Q = sum_c (in_c / 2m - resolution * (tot_c / 2m)^2), where in_c counts
+ * each edge inside community c twice and tot_c is the total weighted degree
+ * of the vertices in c.
+ */
+double compute_modularity(adj_scanner::ptr scanner,
+		const std::vector<vertex_id_t> &comms, size_t num_comms,
+		const std::vector<double> &degrees, double resolution)
+{
+	internal_weight_visitor visitor(scanner->is_directed(), comms.data(),
+			scanner->get_num_threads());
+	scanner->scan_all(visitor);
+	std::vector<double> tots(num_comms);
+	double total = 0;
+	for (size_t i = 0; i < comms.size(); i++) {
+		tots[comms[i]] += degrees[i];
+		total += degrees[i];
+	}
+	if (total == 0)
+		return 0;
+	double q = visitor.get_sum() / total;
+	for (size_t c = 0; c < num_comms; c++)
+		q -= resolution * (tots[c] / total) * (tots[c] / total);
+	return q;
+}
+
+/*
+ * Relabel the communities with consecutive IDs starting from 0.
+ * It returns the number of communities.
+ */
+size_t renumber(std::vector<vertex_id_t> &comms)
+{
+	std::vector<vertex_id_t> ids(comms.size(), INVALID_VERTEX_ID);
+	size_t num = 0;
+	for (size_t i = 0; i < comms.size(); i++) {
+		if (ids[comms[i]] == INVALID_VERTEX_ID)
+			ids[comms[i]] = num++;
+		comms[i] = ids[comms[i]];
+	}
+	return num;
+}
+
+/*
+ * The state of the local moving phase of Louvain on a level. A node is
+ * a vertex in the input graph on the first level and a community of
+ * the previous level on the other levels.
+ */
+class louvain_level
+{
+	std::vector<vertex_id_t> comms;
+	// The total weighted degree of the nodes in each community.
+	std::vector<double> tots;
+	std::vector<vsize_t> sizes;
+	const std::vector<double> &node_weights;
+	double total_weight;
+	double resolution;
+	std::vector<comm_accumulator> accs;
+	std::vector<size_t> num_moved;
+public:
+	louvain_level(const std::vector<double> &_node_weights, double resolution,
+			int num_threads): comms(_node_weights.size()), tots(
+				_node_weights), sizes(_node_weights.size(), 1), node_weights(
+				_node_weights), accs(num_threads), num_moved(num_threads) {
+		for (size_t i = 0; i < comms.size(); i++)
+			comms[i] = i;
+		total_weight = 0;
+		for (size_t i = 0; i < node_weights.size(); i++)
+			total_weight += node_weights[i];
+		this->resolution = resolution;
+	}
+
+	std::vector<vertex_id_t> &get_comms() {
+		return comms;
+	}
+
+	size_t get_num_moved() {
+		size_t sum = 0;
+		for (size_t i = 0; i < num_moved.size(); i++) {
+			sum += num_moved[i];
+			num_moved[i] = 0;
+		}
+		return sum;
+	}
+
+	comm_accumulator &get_accumulator(int thread_id) {
+		return accs[thread_id];
+	}
+
+	/*
+	 * Move a node to the neighboring community with the largest modularity
+	 * gain. The accumulator of the thread holds the edge weights from
+	 * the node to its neighboring communities.
+	 */
+	bool move(vertex_id_t node, int thread_id);
+};
+
+bool louvain_level::move(vertex_id_t node, int thread_id)
+{
+	comm_accumulator &acc = accs[thread_id];
+	vertex_id_t curr = comms[node];
+	double k = node_weights[node];
+	double scale = resolution * k / total_weight;
+	double curr_gain = acc.get_weight(curr) - scale * (tots[curr] - k);
+	vertex_id_t best = curr;
+	double best_gain = curr_gain;
+	for (size_t i = 0; i < acc.get_num_comms(); i++) {
+		vertex_id_t comm = acc.get_comm(i);
+		if (comm == curr)
+			continue;
+		// Two singleton nodes may swap their communities in the same
+		// step. Only allow the node with the larger ID to join the other.
+		if (sizes[curr] == 1 && sizes[comm] == 1 && comm > curr)
+			continue;
+		double gain = acc.get_weight(i) - scale * tots[comm];
+		if (gain > best_gain || (gain == best_gain && best != curr
+					&& comm < best)) {
+			best = comm;
+			best_gain = gain;
+		}
+	}
+	acc.clear();
+	if (best == curr || best_gain - curr_gain < 1e-12 * total_weight)
+		return false;
+
+	atomic_add(&tots[curr], -k);
+	atomic_add(&tots[best], k);
+	__sync_fetch_and_sub(&sizes[curr], 1);
+	__sync_fetch_and_add(&sizes[best], 1);
+	comms[node] = best;
+	num_moved[thread_id]++;
+	return true;
+}
+
+class louvain_visitor: public adj_visitor
+{
+	bool directed;
+	louvain_level &level;
+	char *next_active;
+public:
+	louvain_visitor(bool directed, louvain_level &_level,
+			char *next_active): level(_level) {
+		this->directed = directed;
+		this->next_active = next_active;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		comm_accumulator &acc = level.get_accumulator(thread_id);
+		const vertex_id_t *comms = level.get_comms().data();
+		vertex_id_t id = adj.id;
+		for_each_edge(adj, directed, [&acc, comms, id](vertex_id_t u,
+					double w) {
+				if (u != id)
+					acc.add(comms[u], w);
+				});
+		if (level.move(id, thread_id))
+			activate_neighs(adj, directed, next_active);
+	}
+};
+
+/*
+ * The graph of the communities of a level. It's symmetric and a community
+ * has a self-loop whose weight is twice the weight of the edges inside it.
+ */
+struct comm_graph
+{
+	std::vector<size_t> offs;
+	std::vector<vertex_id_t> neighs;
+	std::vector<double> weights;
+
+	size_t get_num_nodes() const {
+		return offs.size() - 1;
+	}
+
+	/*
+	 * Build the graph from the edges of the nodes in each thread.
+	 */
+	void build(std::vector<std::vector<std::tuple<vertex_id_t, vertex_id_t,
+			double> > > &local_edges, size_t num_nodes);
+};
+
+void comm_graph::build(std::vector<std::vector<std::tuple<vertex_id_t,
+		vertex_id_t, double> > > &local_edges, size_t num_nodes)
+{
+	std::vector<std::tuple<vertex_id_t, vertex_id_t, double> > edges;
+	for (size_t i = 0; i < local_edges.size(); i++) {
+		edges.insert(edges.end(), local_edges[i].begin(),
+				local_edges[i].end());
+		std::vector<std::tuple<vertex_id_t, vertex_id_t, double> >().swap(
+				local_edges[i]);
+	}
+	std::sort(edges.begin(), edges.end());
+	offs.assign(num_nodes + 1, 0);
+	neighs.clear();
+	weights.clear();
+	for (size_t i = 0; i < edges.size(); i++) {
+		vertex_id_t from = std::get<0>(edges[i]);
+		vertex_id_t to = std::get<1>(edges[i]);
+		if (!neighs.empty() && i > 0 && std::get<0>(edges[i - 1]) == from
+				&& neighs.back() == to)
+			weights.back() += std::get<2>(edges[i]);
+		else {
+			neighs.push_back(to);
+			weights.push_back(std::get<2>(edges[i]));
+			offs[from + 1]++;
+		}
+	}
+	for (size_t i = 0; i < num_nodes; i++)
+		offs[i + 1] += offs[i];
+}
+
+/*
+ * Collect the edges between the communities from the adjacency lists of
+ * the input graph. Edges are combined per vertex before they're added to
+ * the thread's edge list.
+ */
+class aggregate_visitor: public adj_visitor
+{
+	bool directed;
+	const vertex_id_t *comms;
+	std::vector<comm_accumulator> accs;
+	std::vector<std::vector<std::tuple<vertex_id_t, vertex_id_t, double> > >
+		&local_edges;
+public:
+	aggregate_visitor(bool directed, const vertex_id_t *comms,
+			std::vector<std::vector<std::tuple<vertex_id_t, vertex_id_t,
+			double> > > &_local_edges): accs(_local_edges.size()),
+			local_edges(_local_edges) {
+		this->directed = directed;
+		this->comms = comms;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		comm_accumulator &acc = accs[thread_id];
+		const vertex_id_t *comms = this->comms;
+		for_each_edge(adj, directed, [&acc, comms](vertex_id_t u, double w) {
+				acc.add(comms[u], w);
+				});
+		vertex_id_t comm = comms[adj.id];
+		for (size_t i = 0; i < acc.get_num_comms(); i++)
+			local_edges[thread_id].push_back(std::make_tuple(comm,
+						acc.get_comm(i), acc.get_weight(i)));
+		acc.clear();
+	}
+};
+
+void aggregate(const comm_graph &graph, const std::vector<vertex_id_t> &comms,
+		size_t num_comms, comm_graph &res, int num_threads)
+{
+	std::vector<std::vector<std::tuple<vertex_id_t, vertex_id_t, double> > >
+		local_edges(num_threads);
+	std::vector<comm_accumulator> accs(num_threads);
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1024)
+	for (size_t node = 0; node < graph.get_num_nodes(); node++) {
+		int thread_id = omp_get_thread_num();
+		comm_accumulator &acc = accs[thread_id];
+		for (size_t i = graph.offs[node]; i < graph.offs[node + 1]; i++)
+			acc.add(comms[graph.neighs[i]], graph.weights[i]);
+		for (size_t i = 0; i < acc.get_num_comms(); i++)
+			local_edges[thread_id].push_back(std::make_tuple(comms[node],
+						acc.get_comm(i), acc.get_weight(i)));
+		acc.clear();
+	}
+	res.build(local_edges, num_comms);
+}
+
+/*
+ * Run the local moving phase on a graph of communities in memory.
+ */
+void move_nodes(const comm_graph &graph, louvain_level &level,
+		unsigned max_passes, double tolerance, int num_threads)
+{
+	size_t num_nodes = graph.get_num_nodes();
+	std::vector<char> active(num_nodes, 1);
+	std::vector<char> next_active(num_nodes);
+	for (unsigned pass = 0; pass < max_passes; pass++) {
+		check_interrupt();
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1024)
+		for (size_t node = 0; node < num_nodes; node++) {
+			if (!active[node])
+				continue;
+			int thread_id = omp_get_thread_num();
+			comm_accumulator &acc = level.get_accumulator(thread_id);
+			const vertex_id_t *comms = level.get_comms().data();
+			for (size_t i = graph.offs[node]; i < graph.offs[node + 1]; i++)
+				if (graph.neighs[i] != node)
+					acc.add(comms[graph.neighs[i]], graph.weights[i]);
+			if (level.move(node, thread_id))
+				for (size_t i = graph.offs[node]; i < graph.offs[node + 1]; i++)
+					next_active[graph.neighs[i]] = 1;
+		}
+		active.swap(next_active);
+		std::fill(next_active.begin(), next_active.end(), 0);
+		if (level.get_num_moved() <= tolerance * num_nodes)
+			break;
+	}
+}
+
+}
+
+community_result::ptr compute_label_propagation(FG_graph::ptr fg,
+		unsigned max_iters, edge_weight_t weight_type, unsigned seed)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg, weight_type);
+	size_t num_vertices = scanner->get_num_vertices();
+	community_result::ptr res(new community_result());
+	res->membership.resize(num_vertices);
+	place_vertex_states(res->membership);
+	for (size_t i = 0; i < num_vertices; i++)
+		res->membership[i] = i;
+
+	std::vector<char> next_active(num_vertices);
+	std::vector<vertex_id_t> vids(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		vids[i] = i;
+	lpa_visitor visitor(scanner->is_directed(), res->membership.data(),
+			next_active.data(), scanner->get_num_threads(), seed);
+	res->num_iters = 0;
+	while (!vids.empty() && res->num_iters < max_iters) {
+		scanner->scan(vids, visitor);
+		res->num_iters++;
+		if (visitor.get_num_changed() == 0)
+			break;
+		vids = get_active(next_active);
+	}
+
+	res->num_comms = renumber(res->membership);
+	std::vector<double> degrees(num_vertices);
+	wdegree_visitor dvisitor(scanner->is_directed(), degrees);
+	scanner->scan_all(dvisitor);
+	res->modularity = compute_modularity(scanner, res->membership,
+			res->num_comms, degrees, 1);
+	return res;
+}
+
+community_result::ptr compute_louvain(FG_graph::ptr fg, unsigned max_levels,
+		unsigned max_passes, double tolerance, double resolution,
+		edge_weight_t weight_type)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg, weight_type);
+	size_t num_vertices = scanner->get_num_vertices();
+	int num_threads = scanner->get_num_threads();
+	bool directed = scanner->is_directed();
+	std::vector<double> degrees(num_vertices);
+	place_vertex_states(degrees);
+	wdegree_visitor dvisitor(directed, degrees);
+	scanner->scan_all(dvisitor);
+
+	community_result::ptr res(new community_result());
+	// The first level runs on the input graph, so it works on graphs in
+	// memory and on SSDs alike.
+	louvain_level level0(degrees, resolution, num_threads);
+	std::vector<char> next_active(num_vertices);
+	std::vector<vertex_id_t> vids(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		vids[i] = i;
+	louvain_visitor visitor(directed, level0, next_active.data());
+	for (unsigned pass = 0; pass < max_passes && !vids.empty(); pass++) {
+		scanner->scan(vids, visitor);
+		if (level0.get_num_moved() <= tolerance * num_vertices)
+			break;
+		vids = get_active(next_active);
+	}
+	res->membership = level0.get_comms();
+	size_t num_comms = renumber(res->membership);
+	res->num_iters = 1;
+
+	// The graphs of communities are much smaller than the input graph,
+	// so the other levels run in memory.
+	if (num_comms < num_vertices && max_levels > 1) {
+		std::vector<std::vector<std::tuple<vertex_id_t, vertex_id_t,
+			double> > > local_edges(num_threads);
+		aggregate_visitor avisitor(directed, res->membership.data(),
+				local_edges);
+		scanner->scan_all(avisitor);
+		comm_graph graph;
+		graph.build(local_edges, num_comms);
+
+		while (res->num_iters < max_levels) {
+			size_t num_nodes = graph.get_num_nodes();
+			std::vector<double> node_weights(num_nodes);
+			for (size_t i = 0; i < num_nodes; i++)
+				for (size_t j = graph.offs[i]; j < graph.offs[i + 1]; j++)
+					node_weights[i] += graph.weights[j];
+			louvain_level level(node_weights, resolution, num_threads);
+			move_nodes(graph, level, max_passes, tolerance, num_threads);
+			std::vector<vertex_id_t> &comms = level.get_comms();
+			num_comms = renumber(comms);
+			res->num_iters++;
+			if (num_comms == num_nodes)
+				break;
+			for (size_t i = 0; i < num_vertices; i++)
+				res->membership[i] = comms[res->membership[i]];
+			comm_graph next;
+			aggregate(graph, comms, num_comms, next, num_threads);
+			graph = std::move(next);
+		}
+	}
+	res->num_comms = num_comms;
+	res->modularity = compute_modularity(scanner, res->membership,
+			res->num_comms, degrees, resolution);
+	return res;
+}
+
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+#include <unordered_map>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+/*
+ * The number of neighbors of each vertex linked in the sampling phase of
+ * Afforest.
+ */
+const vsize_t NUM_SAMPLED_NEIGHS = 2;
+
+/*
+ * The number of vertices sampled to find the largest component.
+ */
+const size_t NUM_COMP_SAMPLES = 1024;
+
+/*
+ * Link each vertex with its first few out-neighbors. In most graphs, this
+ * already connects most vertices of the largest component.
+ */
+class sample_visitor: public adj_visitor
+{
+	concurrent_union_find &uf;
+public:
+	sample_visitor(concurrent_union_find &_uf): uf(_uf) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		vsize_t num = std::min(adj.num_out, NUM_SAMPLED_NEIGHS);
+		for (vsize_t i = 0; i < num; i++)
+			uf.unite(adj.id, adj.out_neighs[i]);
+	}
+};
+
+/*
+ * Link a vertex outside the largest component with the rest of its
+ * neighbors. An edge between the largest component and another vertex is
+ * linked from the other vertex, so a directed graph needs the in-edges
+ * as well.
+ */
+class finish_visitor: public adj_visitor
+{
+	bool directed;
+	concurrent_union_find &uf;
+public:
+	finish_visitor(bool directed, concurrent_union_find &_uf): uf(_uf) {
+		this->directed = directed;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		for (vsize_t i = NUM_SAMPLED_NEIGHS; i < adj.num_out; i++)
+			uf.unite(adj.id, adj.out_neighs[i]);
+		if (directed)
+			for (vsize_t i = 0; i < adj.num_in; i++)
+				uf.unite(adj.id, adj.in_neighs[i]);
+	}
+};
+
+/*
+ * Find the most common root among randomly sampled vertices.
+ */
+vertex_id_t sample_largest_comp(concurrent_union_find &uf)
+{
+	std::mt19937 gen(uf.get_num_vertices());
+	std::uniform_int_distribution<vertex_id_t> dist(0,
+			uf.get_num_vertices() - 1);
+	std::unordered_map<vertex_id_t, size_t> counts;
+	for (size_t i = 0; i < NUM_COMP_SAMPLES; i++)
+		counts[uf.find(dist(gen))]++;
+	auto it = std::max_element(counts.begin(), counts.end(),
+			[](const std::pair<vertex_id_t, size_t> &c1,
+				const std::pair<vertex_id_t, size_t> &c2) {
+			return c1.second < c2.second;
+			});
+	return it->first;
+}
+
+}
+
+component_index::ptr component_index::create(FG_graph::ptr fg)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	component_index::ptr index(new component_index(
+				scanner->get_num_vertices()));
+	concurrent_union_find &uf = index->uf;
+	if (uf.get_num_vertices() == 0)
+		return index;
+
+	sample_visitor sample(uf);
+	scanner->scan_all(sample);
+	uf.compress();
+
+	// The vertices in the largest component don't need to be fetched
+	// again.
+	vertex_id_t largest = sample_largest_comp(uf);
+	std::vector<vertex_id_t> vids;
+	for (size_t i = 0; i < uf.get_num_vertices(); i++)
+		if (uf.find(i) != largest)
+			vids.push_back(i);
+	finish_visitor finish(scanner->is_directed(), uf);
+	scanner->scan(vids, finish);
+	return index;
+}
+
+size_t component_index::add_edges(const std::vector<vertex_id_t> &from,
+		const std::vector<vertex_id_t> &to)
+{
+	assert(from.size() == to.size());
+	size_t num_merges = 0;
+#pragma omp parallel for reduction(+:num_merges)
+	for (size_t i = 0; i < from.size(); i++)
+		num_merges += uf.unite(from[i], to[i]);
+	return num_merges;
+}
+
+std::vector<vertex_id_t> component_index::get_membership()
+{
+	std::vector<vertex_id_t> membership(uf.get_num_vertices());
+#pragma omp parallel for
+	for (size_t i = 0; i < membership.size(); i++)
+		membership[i] = uf.find(i);
+	return membership;
+}
+
+size_t component_index::get_num_comps()
+{
+	size_t num_comps = 0;
+#pragma omp parallel for reduction(+:num_comps)
+	for (size_t i = 0; i < uf.get_num_vertices(); i++)
+		num_comps += uf.find(i) == i;
+	return num_comps;
+}
+
+}
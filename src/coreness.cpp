@@ -0,0 +1,276 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "adj_scan.h"
+#include "checkpoint.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+typedef std::vector<vertex_id_t> bin_t;
+
+/*
+ * Removing a vertex decrements the degree of its remaining neighbors.
+ * A neighbor whose degree drops to the current core number has to be
+ * peeled at the current core number. Otherwise, it has to move to
+ * the bucket of its new degree. Each thread records a vertex the first time
+ * its degree drops in a step, and the main thread moves it once to
+ * the bucket of its degree after the step.
+ */
+class peel_visitor: public adj_visitor
+{
+	bool directed;
+	vsize_t *degrees;
+	const char *removed;
+	char *moved;
+	vsize_t curr_core;
+	std::vector<bin_t> &peel_now;
+	std::vector<bin_t> &moves;
+public:
+	peel_visitor(bool directed, vsize_t *degrees, const char *removed,
+			char *moved, std::vector<bin_t> &_peel_now,
+			std::vector<bin_t> &_moves): peel_now(_peel_now), moves(_moves) {
+		this->directed = directed;
+		this->degrees = degrees;
+		this->removed = removed;
+		this->moved = moved;
+		this->curr_core = 0;
+	}
+
+	void set_core(vsize_t core) {
+		curr_core = core;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		vsize_t *degrees = this->degrees;
+		const char *removed = this->removed;
+		char *moved = this->moved;
+		vsize_t curr_core = this->curr_core;
+		bin_t &now = peel_now[thread_id];
+		bin_t &later = moves[thread_id];
+		for_each_neigh(adj, edge_type::BOTH_EDGES, directed,
+				[degrees, removed, moved, curr_core, &now, &later](vertex_id_t u) {
+				if (removed[u])
+					return;
+				vsize_t new_deg = __sync_sub_and_fetch(&degrees[u], 1);
+				// Only one thread sees the degree crossing the current core.
+				if (new_deg == curr_core)
+					now.push_back(u);
+				else if (new_deg > curr_core && !moved[u]
+					&& !__sync_lock_test_and_set(&moved[u], 1))
+					later.push_back(u);
+			});
+	}
+};
+
+/*
+ * A vertex is valid only in the bucket it's bucketed at. Drop the entries
+ * of removed vertices and of vertices that have moved to a lower bucket,
+ * and return the number of the remaining entries.
+ */
+size_t compact_buckets(std::vector<bin_t> &buckets, vsize_t core,
+		const std::vector<vsize_t> &bucketed, const std::vector<char> &removed)
+{
+	size_t num_entries = 0;
+	for (size_t i = core; i < buckets.size(); i++) {
+		bin_t &bucket = buckets[i];
+		bucket.erase(std::remove_if(bucket.begin(), bucket.end(),
+					[i, &bucketed, &removed](vertex_id_t vid) {
+					return removed[vid] || bucketed[vid] != i;
+					}), bucket.end());
+		bin_t(bucket).swap(bucket);
+		num_entries += bucket.size();
+	}
+	return num_entries;
+}
+
+/*
+ * Only the buckets from the current core number may have vertices, so
+ * they are flattened into offsets and vertices.
+ */
+void save_core_state(checkpointer &ckpter, FG_graph::ptr fg,
+		const std::vector<vsize_t> &degrees, const std::vector<char> &removed,
+		const std::vector<vsize_t> &cores, const std::vector<bin_t> &buckets,
+		vsize_t core, size_t num_removed, vsize_t degeneracy)
+{
+	checkpoint::ptr ckpt = checkpoint::create("coreness", fg);
+	std::vector<size_t> offs(1, 0);
+	std::vector<vertex_id_t> vids;
+	for (size_t i = core; i < buckets.size(); i++) {
+		vids.insert(vids.end(), buckets[i].begin(), buckets[i].end());
+		offs.push_back(vids.size());
+	}
+	ckpt->put("degrees", degrees);
+	ckpt->put("removed", removed);
+	ckpt->put("cores", cores);
+	ckpt->put("bucket_offs", offs);
+	ckpt->put("bucket_vids", vids);
+	ckpt->put_value("core", core);
+	ckpt->put_value("num_removed", num_removed);
+	ckpt->put_value("degeneracy", degeneracy);
+	ckpter.save(ckpt);
+}
+
+bool load_core_state(checkpoint::ptr ckpt, size_t num_vertices,
+		std::vector<vsize_t> &degrees, std::vector<char> &removed,
+		std::vector<vsize_t> &cores, std::vector<bin_t> &buckets,
+		vsize_t &core, size_t &num_removed, vsize_t &degeneracy)
+{
+	std::vector<size_t> offs;
+	std::vector<vertex_id_t> vids;
+	if (!ckpt->get("degrees", degrees) || !ckpt->get("removed", removed)
+			|| !ckpt->get("cores", cores) || !ckpt->get("bucket_offs", offs)
+			|| !ckpt->get("bucket_vids", vids) || offs.empty()
+			|| degrees.size() != num_vertices || removed.size() != num_vertices
+			|| cores.size() != num_vertices || offs.back() != vids.size())
+		return false;
+	core = ckpt->get_value<vsize_t>("core");
+	num_removed = ckpt->get_value<size_t>("num_removed");
+	degeneracy = ckpt->get_value<vsize_t>("degeneracy");
+	buckets.clear();
+	buckets.resize(core + offs.size() - 1);
+	for (size_t i = 0; i + 1 < offs.size(); i++)
+		buckets[core + i].assign(vids.begin() + offs[i],
+				vids.begin() + offs[i + 1]);
+	return true;
+}
+
+}
+
+core_result::ptr compute_coreness(FG_graph::ptr fg)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	size_t num_vertices = scanner->get_num_vertices();
+	int num_threads = scanner->get_num_threads();
+	checkpointer::ptr ckpter = create_checkpointer();
+	checkpoint::ptr resume = take_resume_checkpoint("coreness", fg);
+
+	core_result::ptr res(new core_result());
+	std::vector<vsize_t> degrees;
+	std::vector<char> removed;
+	// A vertex may be in multiple buckets. Only the one it's bucketed at is
+	// valid, and the others are skipped once it's removed. A vertex moves to
+	// a lower bucket at most once a step, and the buckets are compacted once
+	// the stale entries outnumber the remaining vertices, so the buckets
+	// take O(V) memory.
+	std::vector<bin_t> buckets;
+	std::vector<vsize_t> bucketed(num_vertices);
+	size_t num_entries = 0;
+	size_t num_removed = 0;
+	vsize_t core = 0;
+	if (resume) {
+		if (!load_core_state(resume, num_vertices, degrees, removed,
+					res->cores, buckets, core, num_removed, res->degeneracy)) {
+			fprintf(stderr, "the coreness checkpoint is corrupted\n");
+			return core_result::ptr();
+		}
+		// The lowest bucket of a vertex is the one it's valid in.
+		std::vector<char> seen(num_vertices);
+		for (size_t i = core; i < buckets.size(); i++)
+			for (size_t j = 0; j < buckets[i].size(); j++) {
+				vertex_id_t vid = buckets[i][j];
+				if (vid >= num_vertices) {
+					fprintf(stderr, "the coreness checkpoint is corrupted\n");
+					return core_result::ptr();
+				}
+				if (!seen[vid]) {
+					seen[vid] = 1;
+					bucketed[vid] = i;
+				}
+			}
+		num_entries = compact_buckets(buckets, core, bucketed, removed);
+	}
+	else {
+		degrees = scanner->get_degrees(edge_type::BOTH_EDGES);
+		vsize_t max_deg = 0;
+		for (size_t i = 0; i < num_vertices; i++)
+			max_deg = std::max(max_deg, degrees[i]);
+		buckets.resize(max_deg + 1);
+		for (size_t i = 0; i < num_vertices; i++)
+			buckets[degrees[i]].push_back(i);
+		bucketed = degrees;
+		num_entries = num_vertices;
+		res->cores.resize(num_vertices);
+		removed.resize(num_vertices);
+	}
+	place_vertex_states(res->cores);
+
+	std::vector<bin_t> peel_now(num_threads);
+	std::vector<bin_t> moves(num_threads);
+	std::vector<char> moved(num_vertices);
+	peel_visitor visitor(scanner->is_directed(), degrees.data(),
+			removed.data(), moved.data(), peel_now, moves);
+	while (num_removed < num_vertices && core < buckets.size()) {
+		bin_t frontier;
+		for (size_t i = 0; i < buckets[core].size(); i++) {
+			vertex_id_t vid = buckets[core][i];
+			if (!removed[vid]) {
+				removed[vid] = 1;
+				res->cores[vid] = core;
+				frontier.push_back(vid);
+			}
+		}
+		num_entries -= buckets[core].size();
+		bin_t().swap(buckets[core]);
+		if (frontier.empty()) {
+			core++;
+			continue;
+		}
+		num_removed += frontier.size();
+
+		std::sort(frontier.begin(), frontier.end());
+		visitor.set_core(core);
+		scanner->scan(frontier, visitor);
+		for (int i = 0; i < num_threads; i++) {
+			for (size_t j = 0; j < peel_now[i].size(); j++) {
+				buckets[core].push_back(peel_now[i][j]);
+				bucketed[peel_now[i][j]] = core;
+			}
+			num_entries += peel_now[i].size();
+			peel_now[i].clear();
+			for (size_t j = 0; j < moves[i].size(); j++) {
+				vertex_id_t vid = moves[i][j];
+				moved[vid] = 0;
+				// The vertex may have dropped to the current core afterwards.
+				if (degrees[vid] > core && bucketed[vid] != degrees[vid]) {
+					buckets[degrees[vid]].push_back(vid);
+					bucketed[vid] = degrees[vid];
+					num_entries++;
+				}
+			}
+			moves[i].clear();
+		}
+		if (num_entries > 2 * (num_vertices - num_removed) + buckets.size())
+			num_entries = compact_buckets(buckets, core, bucketed, removed);
+		res->degeneracy = core;
+		if (ckpter && ckpter->is_due())
+			save_core_state(*ckpter, fg, degrees, removed, res->cores, buckets,
+					core, num_removed, res->degeneracy);
+	}
+	if (ckpter)
+		ckpter->finish();
+	return res;
+}
+
+}
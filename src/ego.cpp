@@ -0,0 +1,243 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+typedef std::vector<vertex_id_t> vset_t;
+// An edge in an ego-network. The endpoints are the local IDs, i.e.,
+// the locations of the vertices in the sorted ego-network.
+typedef std::pair<vertex_id_t, vertex_id_t> local_edge_t;
+
+/*
+ * The number of seeds whose ego-networks are extracted together.
+ * It bounds the memory for the ego-networks in a batch.
+ */
+const size_t EGO_BATCH_SIZE = 4096;
+
+/*
+ * Collect the edges induced by each ego-network. In a directed graph,
+ * an edge is collected from its source. In an undirected graph, an edge
+ * is collected from both endpoints. The edges are only kept when
+ * the triangles are counted; otherwise, the visitor only counts them.
+ */
+class ego_visitor: public adj_visitor
+{
+	const member_index &index;
+	const std::vector<vset_t> &egos;
+	bool keep_edges;
+	// thread -> ego-network -> edges
+	std::vector<std::vector<std::vector<local_edge_t> > > &local_edges;
+	std::vector<std::vector<size_t> > &local_counts;
+public:
+	ego_visitor(const member_index &_index, const std::vector<vset_t> &_egos,
+			bool keep_edges,
+			std::vector<std::vector<std::vector<local_edge_t> > > &_local_edges,
+			std::vector<std::vector<size_t> > &_local_counts): index(_index),
+			egos(_egos), local_edges(_local_edges), local_counts(_local_counts) {
+		this->keep_edges = keep_edges;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		auto range = index.find(adj.id);
+		for (auto it = range.first; it != range.second; it++) {
+			const vset_t &ego = egos[it->second];
+			vertex_id_t src = std::lower_bound(ego.begin(), ego.end(),
+					adj.id) - ego.begin();
+			size_t count = 0;
+			for (vsize_t i = 0; i < adj.num_out; i++) {
+				auto loc = std::lower_bound(ego.begin(), ego.end(),
+						adj.out_neighs[i]);
+				if (loc == ego.end() || *loc != adj.out_neighs[i])
+					continue;
+				count++;
+				if (keep_edges)
+					local_edges[thread_id][it->second].push_back(
+							local_edge_t(src, loc - ego.begin()));
+			}
+			local_counts[thread_id][it->second] += count;
+		}
+	}
+};
+
+/*
+ * Count the triangles and the wedges in an ego-network. The direction of
+ * edges is ignored and the edges between the same pair of vertices are
+ * merged.
+ */
+void count_ego_triangles(size_t num_vertices,
+		const std::vector<local_edge_t> &edges, ego_stat &stat)
+{
+	std::vector<vset_t> neighs(num_vertices);
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (edges[i].first == edges[i].second)
+			continue;
+		neighs[edges[i].first].push_back(edges[i].second);
+		neighs[edges[i].second].push_back(edges[i].first);
+	}
+	double num_wedges = 0;
+	for (size_t u = 0; u < num_vertices; u++) {
+		std::sort(neighs[u].begin(), neighs[u].end());
+		neighs[u].erase(std::unique(neighs[u].begin(), neighs[u].end()),
+				neighs[u].end());
+		double deg = neighs[u].size();
+		num_wedges += deg * (deg - 1) / 2;
+	}
+
+	// Each triangle u < v < w is counted once from its edge (u, v).
+	size_t num_triangles = 0;
+	for (size_t u = 0; u < num_vertices; u++) {
+		const vset_t &u_neighs = neighs[u];
+		for (size_t i = 0; i < u_neighs.size(); i++) {
+			vertex_id_t v = u_neighs[i];
+			if (v <= u)
+				continue;
+			const vset_t &v_neighs = neighs[v];
+			auto it1 = std::upper_bound(u_neighs.begin(), u_neighs.end(), v);
+			auto it2 = std::upper_bound(v_neighs.begin(), v_neighs.end(), v);
+			while (it1 != u_neighs.end() && it2 != v_neighs.end()) {
+				if (*it1 < *it2)
+					it1++;
+				else if (*it1 > *it2)
+					it2++;
+				else {
+					num_triangles++;
+					it1++;
+					it2++;
+				}
+			}
+		}
+	}
+	stat.num_triangles = num_triangles;
+	stat.transitivity = num_wedges > 0 ? 3 * num_triangles / num_wedges : NAN;
+}
+
+/*
+ * Extract the ego-networks of a batch of seeds at a time and process each
+ * one on a worker thread. `process' gets the location of the seed,
+ * the sorted vertices of its ego-network, the number of edges collected
+ * and the collected edges if `keep_edges' is true.
+ */
+template<class Process>
+void process_ego_networks(adj_scanner::ptr scanner,
+		const std::vector<vertex_id_t> &seeds, int radius, edge_type type,
+		bool keep_edges, Process process)
+{
+	int num_threads = scanner->get_num_threads();
+	for (size_t off = 0; off < seeds.size(); off += EGO_BATCH_SIZE) {
+		std::vector<vertex_id_t> batch(seeds.begin() + off,
+				seeds.begin() + std::min(off + EGO_BATCH_SIZE, seeds.size()));
+		std::vector<vset_t> egos = get_neighborhoods(*scanner, batch, radius,
+				type);
+
+		member_index index(egos);
+		std::vector<std::vector<std::vector<local_edge_t> > > local_edges(
+				num_threads, std::vector<std::vector<local_edge_t> >(
+					keep_edges ? batch.size() : 0));
+		std::vector<std::vector<size_t> > local_counts(num_threads,
+				std::vector<size_t>(batch.size()));
+		ego_visitor visitor(index, egos, keep_edges, local_edges,
+				local_counts);
+		scanner->scan(index.get_vertices(), visitor);
+
+		// Each ego-network is small, so a thread processes an ego-network
+		// by itself.
+#pragma omp parallel for schedule(dynamic, 16)
+		for (size_t i = 0; i < batch.size(); i++) {
+			size_t num_edges = 0;
+			for (int j = 0; j < num_threads; j++)
+				num_edges += local_counts[j][i];
+			std::vector<local_edge_t> edges;
+			if (keep_edges) {
+				for (int j = 0; j < num_threads; j++) {
+					edges.insert(edges.end(), local_edges[j][i].begin(),
+							local_edges[j][i].end());
+					std::vector<local_edge_t>().swap(local_edges[j][i]);
+				}
+			}
+			process(off + i, egos[i], num_edges, edges);
+		}
+	}
+}
+
+}
+
+std::vector<ego_stat> compute_ego_stats(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &seeds, int radius, edge_type type,
+		bool count_triangles)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	bool directed = scanner->is_directed();
+	std::vector<ego_stat> stats(seeds.size());
+	process_ego_networks(scanner, seeds, radius, type, count_triangles,
+			[&stats, directed, count_triangles](size_t idx, const vset_t &ego,
+				size_t num_edges, const std::vector<local_edge_t> &edges) {
+			ego_stat &stat = stats[idx];
+			stat.num_vertices = ego.size();
+			stat.num_edges = directed ? num_edges : num_edges / 2;
+
+			double n = stat.num_vertices;
+			if (stat.num_vertices < 2)
+				stat.density = NAN;
+			else if (directed)
+				stat.density = stat.num_edges / (n * (n - 1));
+			else
+				stat.density = stat.num_edges / (n * (n - 1) / 2);
+
+			stat.num_triangles = NAN;
+			stat.transitivity = NAN;
+			if (count_triangles)
+				count_ego_triangles(stat.num_vertices, edges, stat);
+			});
+	return stats;
+}
+
+void for_each_ego_network(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &seeds, int radius, edge_type type,
+		ego_kernel_t kernel)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	bool directed = scanner->is_directed();
+	process_ego_networks(scanner, seeds, radius, type, true,
+			[&kernel, directed](size_t idx, const vset_t &ego, size_t num_edges,
+				const std::vector<local_edge_t> &edges) {
+			if (directed) {
+				kernel(idx, ego, edges);
+				return;
+			}
+			// An edge of an undirected graph is collected from both
+			// endpoints.
+			std::vector<local_edge_t> uedges;
+			for (size_t i = 0; i < edges.size(); i++)
+				if (edges[i].first <= edges[i].second)
+					uedges.push_back(edges[i]);
+			kernel(idx, ego, uedges);
+			});
+}
+
+}
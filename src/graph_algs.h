@@ -0,0 +1,339 @@
+#ifndef __GRAPH_ALGS_H__
+#define __GRAPH_ALGS_H__
+
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The graph algorithms implemented in FlashGraphR on top of adj_scanner.
+ * They complement the algorithms in libgraph-algs (FGlib.h).
+ */
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "FGlib.h"
+#include "dense_matrix.h"
+
+#include "adj_scan.h"
+#include "union_find.h"
+
+namespace fg
+{
+
+/*
+ * Compute the hop distances from each source vertex to all vertices with
+ * direction-optimizing BFS. Up to 64 sources are traversed together in
+ * a pass. The result is a #vertices x #sources matrix. A vertex that
+ * can't be reached from a source has an infinite distance.
+ */
+fm::dense_matrix::ptr compute_bfs_dists(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type type);
+
+/*
+ * Estimate closeness or harmonic centrality of all vertices from
+ * BFS runs on `num_samples' randomly chosen source vertices.
+ * `type' is the direction of the paths from a vertex to the others.
+ */
+fm::vector::ptr estimate_closeness(FG_graph::ptr fg, size_t num_samples,
+		edge_type type, bool harmonic, unsigned seed);
+
+/*
+ * Estimate the lower bound of the diameter with `num_sweeps' double sweeps.
+ */
+int estimate_diameter_sweeps(FG_graph::ptr fg, int num_sweeps,
+		edge_type type, unsigned seed);
+
+struct sssp_result
+{
+	typedef std::shared_ptr<sssp_result> ptr;
+	std::vector<double> dists;
+	// The predecessor of each vertex in the shortest path tree.
+	// It's INVALID_VERTEX_ID for the sources and unreachable vertices.
+	std::vector<vertex_id_t> preds;
+};
+
+/*
+ * Compute the shortest paths from the nearest source vertex on a weighted
+ * graph with parallel delta-stepping. If `delta' isn't positive, it uses
+ * the average edge weight as the bucket width.
+ */
+sssp_result::ptr compute_sssp(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type type,
+		edge_weight_t weight_type, double delta, bool get_preds);
+
+struct core_result
+{
+	typedef std::shared_ptr<core_result> ptr;
+	std::vector<vsize_t> cores;
+	// The largest core number, i.e., the degeneracy of the graph.
+	vsize_t degeneracy;
+
+	core_result() {
+		degeneracy = 0;
+	}
+};
+
+/*
+ * Compute the core number of every vertex with bucket-based parallel
+ * peeling. The direction of edges is ignored.
+ */
+core_result::ptr compute_coreness(FG_graph::ptr fg);
+
+struct triangle_result
+{
+	double num_triangles;
+	// The number of paths of length two.
+	double num_wedges;
+	// The number of sampled wedges. It's 0 for the exact count.
+	size_t num_samples;
+};
+
+/*
+ * Count the triangles in an undirected graph without materializing
+ * the per-vertex triangle counts. Besides O(V) per-vertex state, it uses
+ * about `mem_size' bytes: a quarter keeps the oriented adjacency lists of
+ * the highest-ranked vertices resident, and the rest holds the oriented
+ * adjacency lists of a batch of vertices. The graph is read once to count
+ * the oriented degrees, once for the resident lists and once for
+ * the batches. Each batch also reads the adjacency lists of the other
+ * endpoints that aren't resident, so the I/O is at most (3 + B) * E for
+ * E undirected edges, where B is about 16 * E / mem_size batches (12 bytes
+ * per oriented edge in three quarters of the memory). The hub vertices, which
+ * most batches request, are usually resident and are read only once.
+ */
+triangle_result count_triangles_exact(FG_graph::ptr fg, size_t mem_size);
+
+/*
+ * Estimate the number of triangles in an undirected graph with wedge
+ * sampling. The number of triangles is within a relative error of `error'
+ * with probability `confidence'.
+ */
+triangle_result count_triangles_sample(FG_graph::ptr fg, double error,
+		double confidence, unsigned seed);
+
+/*
+ * Find the K vertices with the largest scan statistics of the given order,
+ * i.e., the number of edges in the subgraph induced by the vertices within
+ * `order' hops. The direction of edges is ignored when growing
+ * the neighborhoods. Vertices are visited in the descending order of
+ * an upper bound of their scan statistics, and the search stops once
+ * the bound falls to the K-th largest scan statistic found.
+ */
+std::vector<std::pair<vertex_id_t, size_t> > compute_topK_scan_order(
+		FG_graph::ptr fg, int order, size_t K);
+
+/*
+ * Compute the scan statistics of the given order on all vertices.
+ */
+fm::vector::ptr compute_local_scan_order(FG_graph::ptr fg, int order);
+
+struct ego_stat
+{
+	size_t num_vertices;
+	size_t num_edges;
+	double density;
+	// The triangles and the transitivity ignore the direction of edges.
+	// They're NaN if the triangles aren't counted.
+	double num_triangles;
+	double transitivity;
+};
+
+/*
+ * Compute the statistics of the ego-network of each seed vertex, i.e.,
+ * the subgraph induced by the vertices within `radius' hops from the seed
+ * in the specified direction. The ego-networks of many seeds are extracted
+ * together in a few scans over the graph and each one is processed by
+ * a single thread in memory, so the subgraphs are never registered.
+ */
+std::vector<ego_stat> compute_ego_stats(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &seeds, int radius, edge_type type,
+		bool count_triangles);
+
+/*
+ * A kernel on an ego-network gets the location of the seed in the seeds,
+ * the sorted vertices of the ego-network and its edges. An edge refers to
+ * its endpoints by their locations in the vertices. In an undirected graph,
+ * an edge is only given once.
+ */
+typedef std::function<void(size_t, const std::vector<vertex_id_t> &,
+		const std::vector<std::pair<vertex_id_t, vertex_id_t> > &)> ego_kernel_t;
+
+/*
+ * Extract the ego-network of each seed vertex in the same way as
+ * compute_ego_stats and run `kernel' on it. The kernel runs on worker
+ * threads, so it has to be thread-safe.
+ */
+void for_each_ego_network(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &seeds, int radius, edge_type type,
+		ego_kernel_t kernel);
+
+enum class kmeans_method_t
+{
+	// Lloyd's iterations with Hamerly's bounds. A vertex whose bounds
+	// show it can't change its cluster isn't fetched at all.
+	PRUNED,
+	// Sculley's mini-batch k-means. Each iteration only fetches a random
+	// batch of vertices.
+	MINIBATCH,
+};
+
+struct kmeans_iter_stat
+{
+	// The runtime of the iteration in seconds.
+	double time;
+	// The number of vertices whose rows are read.
+	size_t num_fetched;
+	// The number of distance computations skipped compared with a full
+	// Lloyd's iteration, which computes #vertices x k distances.
+	size_t num_pruned;
+	// The number of vertices that change their clusters. It's 0 for
+	// the mini-batch k-means.
+	size_t num_moved;
+};
+
+struct kmeans_result
+{
+	typedef std::shared_ptr<kmeans_result> ptr;
+	std::vector<unsigned> clusters;
+	std::vector<size_t> sizes;
+	// The k x dim centers in the row-major order.
+	std::vector<double> centers;
+	size_t dim;
+	unsigned num_iters;
+	std::vector<kmeans_iter_stat> stats;
+};
+
+/*
+ * Cluster the vertices with semi-external k-means. The row of a vertex is
+ * its out-edges: a neighbor ID is a column index and the edge weight is
+ * the value (1 without edge weights). Only the centers and a few values
+ * per vertex are kept in memory, and the rows are read from the graph in
+ * each iteration. `init' is "random" or "forgy". The pruned method stops
+ * when the fraction of vertices that change clusters is at most
+ * `tolerance'; the mini-batch method stops when no center moves more
+ * than `tolerance'.
+ */
+kmeans_result::ptr compute_kmeans(FG_graph::ptr fg, unsigned k,
+		const std::string &init, unsigned max_iters, double tolerance,
+		kmeans_method_t method, size_t batch_size, edge_weight_t weight_type,
+		unsigned seed);
+
+struct community_result
+{
+	typedef std::shared_ptr<community_result> ptr;
+	// The community of each vertex. The IDs are consecutive from 0.
+	std::vector<vertex_id_t> membership;
+	size_t num_comms;
+	double modularity;
+	// The number of iterations of label propagation or the number of
+	// levels of Louvain.
+	unsigned num_iters;
+};
+
+/*
+ * Detect communities with parallel label propagation. The direction of
+ * edges is ignored. Only the vertices whose neighbors changed labels are
+ * revisited in an iteration.
+ */
+community_result::ptr compute_label_propagation(FG_graph::ptr fg,
+		unsigned max_iters, edge_weight_t weight_type, unsigned seed);
+
+/*
+ * Detect communities with parallel Louvain. The direction of edges is
+ * ignored. The local moving phase on the first level reads the input graph
+ * with adj_scanner and the later levels run on the graph of communities
+ * in memory. A level ends when the fraction of nodes that move in a pass is
+ * at most `tolerance'.
+ */
+community_result::ptr compute_louvain(FG_graph::ptr fg, unsigned max_levels,
+		unsigned max_passes, double tolerance, double resolution,
+		edge_weight_t weight_type);
+
+struct walk_options
+{
+	// The number of vertices in a walk, including the start vertex.
+	int length;
+	size_t walks_per_vertex;
+	// The return parameter and the in-out parameter of node2vec.
+	// A walk is first-order (DeepWalk) when both of them are 1.
+	double p;
+	double q;
+	edge_type type;
+	unsigned seed;
+};
+
+// The vertices after the end of a walk that stops at a vertex without
+// neighbors.
+const vertex_id_t WALK_END = INVALID_VERTEX_ID;
+
+/*
+ * Generate random walks from the start vertices. Each round of walks starts
+ * from every start vertex once. The walks run in batches, and all walks in
+ * a batch take a step together, so the adjacency lists they need in
+ * the step are fetched in a single scan. Second-order walks use rejection
+ * sampling and fetch the adjacency lists of their previous vertices in
+ * another scan. Each batch is passed to `consume' as rows of `length'
+ * vertices.
+ */
+void generate_random_walks(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &starts, const walk_options &opts,
+		std::function<void (const vertex_id_t *, size_t)> consume);
+
+/*
+ * The weakly connected components of a graph kept in a concurrent
+ * union-find, so they can be updated as edges are inserted.
+ */
+class component_index
+{
+	concurrent_union_find uf;
+
+	component_index(size_t num_vertices): uf(num_vertices) {
+	}
+public:
+	typedef std::shared_ptr<component_index> ptr;
+
+	/*
+	 * Compute the components with Afforest: link every vertex with its first
+	 * two out-neighbors, find the largest component by sampling and link
+	 * the remaining edges of the vertices outside it. The vertices in
+	 * the largest component are only fetched once, and unlike label
+	 * propagation, the number of passes doesn't depend on the diameter.
+	 */
+	static ptr create(FG_graph::ptr fg);
+
+	size_t get_num_vertices() const {
+		return uf.get_num_vertices();
+	}
+
+	/*
+	 * Insert edges in parallel. It returns the number of components merged.
+	 */
+	size_t add_edges(const std::vector<vertex_id_t> &from,
+			const std::vector<vertex_id_t> &to);
+	/*
+	 * The component of a vertex is identified by the smallest vertex in it.
+	 */
+	std::vector<vertex_id_t> get_membership();
+	size_t get_num_comps();
+};
+
+}
+
+#endif
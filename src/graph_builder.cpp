@@ -0,0 +1,779 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <type_traits>
+
+#include "vertex.h"
+#include "graph_file_header.h"
+#include "vertex_index_constructor.h"
+
+#include "graph_builder.h"
+
+namespace fg
+{
+
+namespace
+{
+
+/*
+ * The size of the text chunks of an edge list file given to a parser thread.
+ */
+const size_t CHUNK_SIZE = 64 * 1024 * 1024;
+/*
+ * The smallest read buffer of a run in a merge. If the runs don't fit in
+ * memory with the buffers of this size, they're merged in multiple passes.
+ */
+const size_t MIN_MERGE_BUF_SIZE = 1024 * 1024;
+
+/*
+ * An edge in a run. `v' is the vertex whose adjacency list contains
+ * the edge and `u' is the neighbor, so runs of out-edges store (src, dst)
+ * and runs of in-edges store (dst, src).
+ */
+template<class AttrType>
+struct run_edge
+{
+	vertex_id_t v;
+	vertex_id_t u;
+	AttrType attr;
+
+	bool operator<(const run_edge &e) const {
+		return v < e.v || (v == e.v && u < e.u);
+	}
+};
+
+template<class AttrType>
+bool parse_attr(const char *&p, AttrType &attr);
+
+template<>
+bool parse_attr<empty_data>(const char *&p, empty_data &attr)
+{
+	return true;
+}
+
+template<>
+bool parse_attr<int>(const char *&p, int &attr)
+{
+	char *end;
+	attr = strtol(p, &end, 10);
+	bool ret = end != p;
+	p = end;
+	return ret;
+}
+
+template<>
+bool parse_attr<long>(const char *&p, long &attr)
+{
+	char *end;
+	attr = strtoll(p, &end, 10);
+	bool ret = end != p;
+	p = end;
+	return ret;
+}
+
+template<>
+bool parse_attr<float>(const char *&p, float &attr)
+{
+	char *end;
+	attr = strtof(p, &end);
+	bool ret = end != p;
+	p = end;
+	return ret;
+}
+
+template<>
+bool parse_attr<double>(const char *&p, double &attr)
+{
+	char *end;
+	attr = strtod(p, &end);
+	bool ret = end != p;
+	p = end;
+	return ret;
+}
+
+template<class AttrType>
+edge<AttrType> make_edge(vertex_id_t from, vertex_id_t to,
+		const AttrType &attr)
+{
+	return edge<AttrType>(from, to, attr);
+}
+
+template<>
+edge<empty_data> make_edge<empty_data>(vertex_id_t from, vertex_id_t to,
+		const empty_data &attr)
+{
+	return edge<empty_data>(from, to);
+}
+
+/*
+ * A file writer that writes a full buffer in the background while
+ * the caller fills the other buffer.
+ */
+class async_writer
+{
+	FILE *f;
+	std::string name;
+	std::vector<char> buf;
+	std::vector<char> pending;
+	std::future<bool> write_res;
+	bool failed;
+
+	void write_buf() {
+		if (write_res.valid() && !write_res.get())
+			failed = true;
+		buf.swap(pending);
+		buf.clear();
+		write_res = std::async(std::launch::async, [this]() {
+				return fwrite(pending.data(), pending.size(), 1, f) == 1;
+				});
+	}
+public:
+	async_writer(const std::string &name, size_t buf_size,
+			const char *mode = "w") {
+		this->name = name;
+		f = fopen(name.c_str(), mode);
+		failed = f == NULL;
+		if (failed)
+			fprintf(stderr, "can't open %s: %s\n", name.c_str(),
+					strerror(errno));
+		buf.reserve(buf_size);
+		pending.reserve(buf_size);
+	}
+
+	~async_writer() {
+		close();
+	}
+
+	bool write(const void *data, size_t size) {
+		if (failed)
+			return false;
+		const char *p = (const char *) data;
+		while (size > 0) {
+			size_t len = std::min(size, buf.capacity() - buf.size());
+			buf.insert(buf.end(), p, p + len);
+			p += len;
+			size -= len;
+			if (buf.size() == buf.capacity())
+				write_buf();
+		}
+		return true;
+	}
+
+	/*
+	 * Write all data in the buffers and close the file.
+	 */
+	bool close() {
+		if (f == NULL)
+			return !failed;
+		if (!buf.empty())
+			write_buf();
+		if (write_res.valid() && !write_res.get())
+			failed = true;
+		if (fclose(f) != 0)
+			failed = true;
+		f = NULL;
+		if (failed)
+			fprintf(stderr, "can't write %s\n", name.c_str());
+		return !failed;
+	}
+};
+
+/*
+ * A reader of a run that reads the next buffer in the background while
+ * the caller consumes the current one.
+ */
+template<class EdgeType>
+class run_reader
+{
+	FILE *f;
+	std::vector<EdgeType> buf;
+	std::vector<EdgeType> next;
+	std::future<size_t> next_res;
+	size_t buf_len;
+	size_t idx;
+
+	void prefetch() {
+		next.resize(buf_len);
+		next_res = std::async(std::launch::async, [this]() {
+				return fread(next.data(), sizeof(EdgeType), next.size(), f);
+				});
+	}
+public:
+	run_reader(const std::string &name, size_t buf_len) {
+		this->buf_len = buf_len;
+		idx = 0;
+		f = fopen(name.c_str(), "r");
+		if (f == NULL) {
+			fprintf(stderr, "can't open %s: %s\n", name.c_str(),
+					strerror(errno));
+			return;
+		}
+		buf.resize(buf_len);
+		buf.resize(fread(buf.data(), sizeof(EdgeType), buf.size(), f));
+		if (!buf.empty())
+			prefetch();
+	}
+
+	~run_reader() {
+		if (next_res.valid())
+			next_res.wait();
+		if (f)
+			fclose(f);
+	}
+
+	bool is_valid() const {
+		return f != NULL;
+	}
+
+	bool has_next() const {
+		return idx < buf.size();
+	}
+
+	const EdgeType &peek() const {
+		return buf[idx];
+	}
+
+	void pop() {
+		idx++;
+		if (idx < buf.size() || !next_res.valid())
+			return;
+		next.resize(next_res.get());
+		buf.swap(next);
+		idx = 0;
+		if (!buf.empty())
+			prefetch();
+	}
+};
+
+/*
+ * Merge sorted runs into a single sorted stream of edges.
+ */
+template<class EdgeType>
+class run_merger
+{
+	typedef std::pair<EdgeType, size_t> head_t;
+	struct head_greater {
+		bool operator()(const head_t &h1, const head_t &h2) const {
+			return h2.first < h1.first
+				|| (!(h1.first < h2.first) && h1.second > h2.second);
+		}
+	};
+
+	std::vector<std::unique_ptr<run_reader<EdgeType> > > readers;
+	std::priority_queue<head_t, std::vector<head_t>, head_greater> heads;
+	bool valid;
+public:
+	run_merger(const std::vector<std::string> &runs, size_t buf_len) {
+		valid = true;
+		for (size_t i = 0; i < runs.size(); i++) {
+			readers.emplace_back(new run_reader<EdgeType>(runs[i], buf_len));
+			if (!readers.back()->is_valid())
+				valid = false;
+			else if (readers.back()->has_next())
+				heads.push(head_t(readers.back()->peek(), i));
+		}
+	}
+
+	bool is_valid() const {
+		return valid;
+	}
+
+	bool has_next() const {
+		return !heads.empty();
+	}
+
+	const EdgeType &peek() const {
+		return heads.top().first;
+	}
+
+	void pop() {
+		size_t i = heads.top().second;
+		heads.pop();
+		readers[i]->pop();
+		if (readers[i]->has_next())
+			heads.push(head_t(readers[i]->peek(), i));
+	}
+};
+
+/*
+ * The sorted runs of the edges in one direction. For an undirected graph,
+ * all edges are in the runs of out-edges in both directions.
+ */
+struct run_set
+{
+	std::vector<std::string> runs;
+	std::mutex lock;
+	size_t num_created;
+
+	run_set() {
+		num_created = 0;
+	}
+
+	void add(const std::string &run) {
+		std::lock_guard<std::mutex> guard(lock);
+		runs.push_back(run);
+	}
+
+	std::string get_name(const std::string &prefix) {
+		std::lock_guard<std::mutex> guard(lock);
+		return prefix + "-" + std::to_string(num_created++) + ".run";
+	}
+};
+
+template<class EdgeType>
+bool write_run(const std::vector<EdgeType> &edges, const std::string &name)
+{
+	async_writer writer(name, MIN_MERGE_BUF_SIZE);
+	writer.write(edges.data(), edges.size() * sizeof(edges[0]));
+	return writer.close();
+}
+
+/*
+ * A parser thread fills the buffers of the edges. When they're full, it
+ * sorts and writes them to runs in the background and continues with
+ * a new set of buffers, so at most two sets of buffers exist at a time.
+ */
+template<class AttrType>
+class run_generator
+{
+	typedef run_edge<AttrType> edge_t;
+
+	const ext_build_options &opts;
+	std::string out_prefix;
+	std::string in_prefix;
+	run_set &out_runs;
+	run_set &in_runs;
+	size_t buf_len;
+	std::vector<edge_t> out_buf;
+	std::vector<edge_t> in_buf;
+	std::future<bool> spill_res;
+	bool failed;
+	vertex_id_t max_id;
+	size_t num_edges;
+
+	bool is_delim(char c) const {
+		if (opts.delim == "auto")
+			return isspace(c) || c == ',';
+		else
+			return c == opts.delim[0] || c == ' ';
+	}
+
+	void add_edge(vertex_id_t from, vertex_id_t to, const AttrType &attr);
+	void spill();
+public:
+	run_generator(const ext_build_options &_opts, const std::string &prefix,
+			run_set &_out_runs, run_set &_in_runs, size_t buf_len): opts(_opts),
+			out_runs(_out_runs), in_runs(_in_runs) {
+		out_prefix = prefix + "-out";
+		in_prefix = prefix + "-in";
+		this->buf_len = buf_len;
+		failed = false;
+		max_id = 0;
+		num_edges = 0;
+	}
+
+	bool parse_chunk(const std::string &file, off_t start, off_t end);
+	bool finish();
+
+	vertex_id_t get_max_id() const {
+		return max_id;
+	}
+
+	size_t get_num_edges() const {
+		return num_edges;
+	}
+};
+
+template<class AttrType>
+void run_generator<AttrType>::spill()
+{
+	if (spill_res.valid() && !spill_res.get())
+		failed = true;
+	// The task owns the full buffers.
+	std::shared_ptr<std::vector<edge_t> > outs(new std::vector<edge_t>());
+	std::shared_ptr<std::vector<edge_t> > ins(new std::vector<edge_t>());
+	outs->swap(out_buf);
+	ins->swap(in_buf);
+	std::string out_name = out_runs.get_name(out_prefix);
+	std::string in_name = in_runs.get_name(in_prefix);
+	run_set *out_set = &out_runs;
+	run_set *in_set = &in_runs;
+	spill_res = std::async(std::launch::async, [=]() {
+			std::sort(outs->begin(), outs->end());
+			if (!write_run(*outs, out_name))
+				return false;
+			out_set->add(out_name);
+			if (ins->empty())
+				return true;
+			std::sort(ins->begin(), ins->end());
+			if (!write_run(*ins, in_name))
+				return false;
+			in_set->add(in_name);
+			return true;
+			});
+	out_buf.reserve(buf_len);
+	if (opts.directed)
+		in_buf.reserve(buf_len);
+}
+
+template<class AttrType>
+void run_generator<AttrType>::add_edge(vertex_id_t from, vertex_id_t to,
+		const AttrType &attr)
+{
+	if (out_buf.capacity() < buf_len)
+		out_buf.reserve(buf_len);
+	edge_t e;
+	e.v = from;
+	e.u = to;
+	e.attr = attr;
+	out_buf.push_back(e);
+	std::swap(e.v, e.u);
+	if (opts.directed) {
+		if (in_buf.capacity() < buf_len)
+			in_buf.reserve(buf_len);
+		in_buf.push_back(e);
+	}
+	// An undirected edge is in the adjacency lists of both endpoints.
+	else
+		out_buf.push_back(e);
+	max_id = std::max(max_id, std::max(from, to));
+	num_edges++;
+	if (out_buf.size() + 1 >= buf_len)
+		spill();
+}
+
+template<class AttrType>
+bool run_generator<AttrType>::parse_chunk(const std::string &file,
+		off_t start, off_t end)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	if (f == NULL) {
+		fprintf(stderr, "can't open %s: %s\n", file.c_str(), strerror(errno));
+		return false;
+	}
+	// A line belongs to the chunk where it starts.
+	if (start > 0) {
+		fseeko(f, start - 1, SEEK_SET);
+		int c;
+		while ((c = fgetc(f)) != EOF && c != '\n');
+	}
+
+	char *line = NULL;
+	size_t line_size = 0;
+	while (ftello(f) < end && getline(&line, &line_size, f) > 0) {
+		const char *p = line;
+		while (isspace(*p))
+			p++;
+		// Skip empty lines and comments.
+		if (*p == 0 || *p == '#')
+			continue;
+		char *num_end;
+		vertex_id_t from = strtoul(p, &num_end, 10);
+		if (num_end == p)
+			continue;
+		p = num_end;
+		while (*p && is_delim(*p))
+			p++;
+		vertex_id_t to = strtoul(p, &num_end, 10);
+		if (num_end == p)
+			continue;
+		p = num_end;
+		while (*p && is_delim(*p))
+			p++;
+		AttrType attr = AttrType();
+		if (!parse_attr<AttrType>(p, attr))
+			continue;
+		add_edge(from, to, attr);
+	}
+	free(line);
+	fclose(f);
+	return !failed;
+}
+
+template<class AttrType>
+bool run_generator<AttrType>::finish()
+{
+	if (!out_buf.empty())
+		spill();
+	if (spill_res.valid() && !spill_res.get())
+		failed = true;
+	return !failed;
+}
+
+void remove_runs(const std::vector<std::string> &runs)
+{
+	for (size_t i = 0; i < runs.size(); i++)
+		unlink(runs[i].c_str());
+}
+
+/*
+ * Merge the runs until at most `max_fan_in' runs are left, so the final
+ * merge can give every run a read buffer large enough for sequential I/O.
+ */
+template<class EdgeType>
+bool reduce_runs(std::vector<std::string> &runs, size_t max_fan_in,
+		size_t buf_len, run_set &names, const std::string &prefix)
+{
+	while (runs.size() > max_fan_in) {
+		std::vector<std::string> merged;
+		for (size_t i = 0; i < runs.size(); i += max_fan_in) {
+			std::vector<std::string> group(runs.begin() + i,
+					runs.begin() + std::min(i + max_fan_in, runs.size()));
+			if (group.size() == 1) {
+				merged.push_back(group[0]);
+				continue;
+			}
+			std::string name = names.get_name(prefix);
+			run_merger<EdgeType> merger(group, buf_len);
+			if (!merger.is_valid())
+				return false;
+			async_writer writer(name, buf_len * sizeof(EdgeType));
+			for (; merger.has_next(); merger.pop())
+				writer.write(&merger.peek(), sizeof(EdgeType));
+			if (!writer.close())
+				return false;
+			remove_runs(group);
+			merged.push_back(name);
+		}
+		runs.swap(merged);
+	}
+	return true;
+}
+
+bool append_file(const std::string &from, async_writer &to, size_t buf_size)
+{
+	FILE *f = fopen(from.c_str(), "r");
+	if (f == NULL) {
+		fprintf(stderr, "can't open %s: %s\n", from.c_str(), strerror(errno));
+		return false;
+	}
+	std::vector<char> buf(buf_size);
+	size_t ret;
+	bool success = true;
+	while ((ret = fread(buf.data(), 1, buf.size(), f)) > 0)
+		if (!to.write(buf.data(), ret)) {
+			success = false;
+			break;
+		}
+	fclose(f);
+	return success;
+}
+
+template<class AttrType>
+bool build_graph(const std::vector<std::string> &edge_files,
+		const std::string &adj_file, const std::string &index_file,
+		const ext_build_options &opts)
+{
+	typedef run_edge<AttrType> edge_t;
+	int num_threads = std::max(opts.num_threads, 1);
+	size_t num_streams = opts.directed ? 2 : 1;
+	// Each thread has two sets of buffers: one is being filled and
+	// the other is being sorted and written.
+	size_t buf_len = opts.mem_size / num_threads / 2 / num_streams
+		/ sizeof(edge_t);
+	if (buf_len < 1024) {
+		fprintf(stderr, "the memory size is too small for %d threads\n",
+				num_threads);
+		return false;
+	}
+
+	std::vector<std::pair<std::string, std::pair<off_t, off_t> > > chunks;
+	for (size_t i = 0; i < edge_files.size(); i++) {
+		struct stat st;
+		if (stat(edge_files[i].c_str(), &st) < 0) {
+			fprintf(stderr, "can't stat %s: %s\n", edge_files[i].c_str(),
+					strerror(errno));
+			return false;
+		}
+		for (off_t off = 0; off < st.st_size; off += CHUNK_SIZE)
+			chunks.push_back(std::make_pair(edge_files[i], std::make_pair(off,
+							std::min<off_t>(off + CHUNK_SIZE, st.st_size))));
+	}
+
+	std::string prefix = opts.tmp_dir + "/" + std::to_string(getpid()) + "-"
+		+ adj_file.substr(adj_file.find_last_of('/') + 1);
+	run_set out_runs;
+	run_set in_runs;
+	std::vector<std::unique_ptr<run_generator<AttrType> > > gens;
+	for (int i = 0; i < num_threads; i++)
+		gens.emplace_back(new run_generator<AttrType>(opts,
+					prefix + "-" + std::to_string(i), out_runs, in_runs,
+					buf_len));
+	bool success = true;
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+	for (size_t i = 0; i < chunks.size(); i++) {
+		if (!gens[omp_get_thread_num()]->parse_chunk(chunks[i].first,
+					chunks[i].second.first, chunks[i].second.second))
+			success = false;
+	}
+	vertex_id_t max_id = 0;
+	size_t num_edges = 0;
+	bool has_edges = false;
+	for (int i = 0; i < num_threads; i++) {
+		if (!gens[i]->finish())
+			success = false;
+		if (gens[i]->get_num_edges() > 0) {
+			has_edges = true;
+			max_id = std::max(max_id, gens[i]->get_max_id());
+			num_edges += gens[i]->get_num_edges();
+		}
+	}
+	gens.clear();
+	if (!success || !has_edges) {
+		if (success)
+			fprintf(stderr, "there aren't edges in the edge lists\n");
+		remove_runs(out_runs.runs);
+		remove_runs(in_runs.runs);
+		return false;
+	}
+
+	// The final merge gives each run two read buffers.
+	size_t max_fan_in = std::max<size_t>(2,
+			opts.mem_size / num_streams / 2 / MIN_MERGE_BUF_SIZE);
+	size_t merge_buf_len = MIN_MERGE_BUF_SIZE / sizeof(edge_t);
+	if (!reduce_runs<edge_t>(out_runs.runs, max_fan_in, merge_buf_len,
+				out_runs, prefix + "-out")
+			|| !reduce_runs<edge_t>(in_runs.runs, max_fan_in, merge_buf_len,
+				in_runs, prefix + "-in")) {
+		remove_runs(out_runs.runs);
+		remove_runs(in_runs.runs);
+		return false;
+	}
+	size_t num_runs = std::max(out_runs.runs.size() + in_runs.runs.size(),
+			(size_t) 1);
+	merge_buf_len = std::max(merge_buf_len,
+			opts.mem_size / num_runs / 2 / sizeof(edge_t));
+
+	bool has_data = !std::is_same<AttrType, empty_data>::value;
+	size_t edge_data_size = has_data ? sizeof(AttrType) : 0;
+	size_t num_vertices = ((size_t) max_id) + 1;
+	// The header of an undirected graph counts an edge once.
+	graph_header header(opts.directed ? graph_type::DIRECTED
+			: graph_type::UNDIRECTED, num_vertices, num_edges, edge_data_size);
+	vertex_index_construct::ptr index
+		= vertex_index_construct::create_compressed(opts.directed,
+				edge_data_size);
+
+	// In a directed graph, all in-edge lists precede all out-edge lists in
+	// the graph file, so the out-edge lists are written to a temporary file
+	// and appended at the end.
+	std::string out_part = prefix + "-out-part";
+	{
+		run_merger<edge_t> out_merger(out_runs.runs, merge_buf_len);
+		run_merger<edge_t> in_merger(in_runs.runs, merge_buf_len);
+		async_writer adj_writer(adj_file, MIN_MERGE_BUF_SIZE * 16);
+		std::unique_ptr<async_writer> out_writer;
+		if (opts.directed)
+			out_writer.reset(new async_writer(out_part,
+						MIN_MERGE_BUF_SIZE * 16));
+		std::vector<char> header_buf(graph_header::get_header_size());
+		memcpy(header_buf.data(), &header, sizeof(header));
+		adj_writer.write(header_buf.data(), header_buf.size());
+
+		std::vector<char> buf;
+		success = out_merger.is_valid() && in_merger.is_valid();
+		for (size_t v = 0; v < num_vertices && success; v++) {
+			if (opts.directed) {
+				in_mem_directed_vertex<AttrType> vertex(v, has_data);
+				for (; in_merger.has_next() && in_merger.peek().v == v;
+						in_merger.pop())
+					vertex.add_in_edge(make_edge<AttrType>(in_merger.peek().u,
+								v, in_merger.peek().attr));
+				for (; out_merger.has_next() && out_merger.peek().v == v;
+						out_merger.pop())
+					vertex.add_out_edge(make_edge<AttrType>(v,
+								out_merger.peek().u, out_merger.peek().attr));
+				index->add_vertex(vertex);
+				buf.resize(vertex.get_serialize_size(edge_type::IN_EDGE));
+				ext_mem_undirected_vertex::serialize(vertex, buf.data(),
+						buf.size(), edge_type::IN_EDGE);
+				success = adj_writer.write(buf.data(), buf.size());
+				buf.resize(vertex.get_serialize_size(edge_type::OUT_EDGE));
+				ext_mem_undirected_vertex::serialize(vertex, buf.data(),
+						buf.size(), edge_type::OUT_EDGE);
+				success = success && out_writer->write(buf.data(), buf.size());
+			}
+			else {
+				in_mem_undirected_vertex<AttrType> vertex(v, has_data);
+				for (; out_merger.has_next() && out_merger.peek().v == v;
+						out_merger.pop())
+					vertex.add_edge(make_edge<AttrType>(v,
+								out_merger.peek().u, out_merger.peek().attr));
+				index->add_vertex(vertex);
+				buf.resize(vertex.get_serialize_size(edge_type::OUT_EDGE));
+				ext_mem_undirected_vertex::serialize(vertex, buf.data(),
+						buf.size(), edge_type::OUT_EDGE);
+				success = adj_writer.write(buf.data(), buf.size());
+			}
+		}
+		if (out_writer && !out_writer->close())
+			success = false;
+		if (success && opts.directed)
+			success = append_file(out_part, adj_writer,
+					MIN_MERGE_BUF_SIZE * 16);
+		if (!adj_writer.close())
+			success = false;
+	}
+	unlink(out_part.c_str());
+	remove_runs(out_runs.runs);
+	remove_runs(in_runs.runs);
+	if (!success)
+		return false;
+
+	vertex_index::ptr vindex = index->dump(header, true);
+	vindex->dump(index_file);
+	return true;
+}
+
+}
+
+bool build_graph_ext_mem(const std::vector<std::string> &edge_files,
+		const std::string &adj_file, const std::string &index_file,
+		const ext_build_options &opts)
+{
+	if (opts.attr_type.empty())
+		return build_graph<empty_data>(edge_files, adj_file, index_file, opts);
+	else if (opts.attr_type == "I")
+		return build_graph<int>(edge_files, adj_file, index_file, opts);
+	else if (opts.attr_type == "L")
+		return build_graph<long>(edge_files, adj_file, index_file, opts);
+	else if (opts.attr_type == "F")
+		return build_graph<float>(edge_files, adj_file, index_file, opts);
+	else if (opts.attr_type == "D")
+		return build_graph<double>(edge_files, adj_file, index_file, opts);
+	else {
+		fprintf(stderr, "unknown attribute type %s\n", opts.attr_type.c_str());
+		return false;
+	}
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef __GRAPH_BUILDER_H__
+#define __GRAPH_BUILDER_H__
+
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+namespace fg
+{
+
+/*
+ * The options of building a graph from edge lists in external memory.
+ */
+struct ext_build_options
+{
+	bool directed;
+	// The delimiter of the columns. "auto" accepts white spaces and commas.
+	std::string delim;
+	// The type of the edge attribute in the third column:
+	// "I", "L", "F", "D" or "" for no attribute.
+	std::string attr_type;
+	// The memory in bytes for the edges buffered in memory. The parsers
+	// and the merge stay within it.
+	size_t mem_size;
+	// The directory for the sorted runs.
+	std::string tmp_dir;
+	int num_threads;
+};
+
+/*
+ * Build the adjacency list file and the index file of a graph from edge
+ * list files without loading the edge lists into memory. The parser threads
+ * fill sorted runs and spill them to `tmp_dir' in the background. The runs
+ * are then merged, and the adjacency lists of the vertices are written to
+ * the graph file in the order of vertex IDs as they come out of the merge.
+ */
+bool build_graph_ext_mem(const std::vector<std::string> &edge_files,
+		const std::string &adj_file, const std::string &index_file,
+		const ext_build_options &opts);
+
+}
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "graph_catalog.h"
+
+namespace fg
+{
+
+namespace
+{
+
+/*
+ * The first line of a catalog file. The entries follow it, one in a line
+ * with tab-separated fields.
+ */
+const std::string CATALOG_HEADER = "# FlashGraphR graph catalog 1";
+
+bool parse_entry(const std::string &line, graph_entry &entry)
+{
+	std::vector<std::string> fields;
+	std::stringstream ss(line);
+	std::string field;
+	while (std::getline(ss, field, '\t'))
+		fields.push_back(field);
+	if (fields.size() != 9)
+		return false;
+	entry.name = fields[0];
+	entry.in_safs = fields[1] == "1";
+	entry.has_header = fields[2] == "1";
+	entry.directed = fields[3] == "1";
+	entry.num_vertices = strtoull(fields[4].c_str(), NULL, 10);
+	entry.num_edges = strtoull(fields[5].c_str(), NULL, 10);
+	entry.size = strtoull(fields[6].c_str(), NULL, 10);
+	entry.adj_file = fields[7];
+	entry.index_file = fields[8];
+	return true;
+}
+
+/*
+ * The lock of a catalog file. The catalog file is replaced by a rename,
+ * so the lock is held on a separate file that is never replaced.
+ */
+class catalog_lock
+{
+	int fd;
+public:
+	catalog_lock(const std::string &file) {
+		std::string lock_file = file + ".lock";
+		fd = open(lock_file.c_str(), O_RDWR | O_CREAT, 0644);
+		if (fd < 0)
+			fprintf(stderr, "can't open the catalog lock %s: %s\n",
+					lock_file.c_str(), strerror(errno));
+		else if (flock(fd, LOCK_EX) < 0) {
+			fprintf(stderr, "can't lock the catalog %s: %s\n",
+					lock_file.c_str(), strerror(errno));
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	~catalog_lock() {
+		if (fd >= 0) {
+			flock(fd, LOCK_UN);
+			close(fd);
+		}
+	}
+
+	bool is_locked() const {
+		return fd >= 0;
+	}
+};
+
+}
+
+graph_catalog::graph_catalog(const std::string &file)
+{
+	this->file = file;
+	loaded = !file.empty() && load();
+}
+
+bool graph_catalog::load()
+{
+	std::ifstream in(file);
+	std::string line;
+	if (!in.good() || !std::getline(in, line) || line != CATALOG_HEADER)
+		return false;
+	entries.clear();
+	while (std::getline(in, line)) {
+		graph_entry entry;
+		if (parse_entry(line, entry))
+			entries[entry.name] = entry;
+		else
+			fprintf(stderr, "wrong catalog entry: %s\n", line.c_str());
+	}
+	return true;
+}
+
+bool graph_catalog::save() const
+{
+	// The catalog isn't persisted without a file.
+	if (file.empty())
+		return false;
+
+	// Write a new file and rename it, so a crash doesn't leave
+	// a truncated catalog.
+	std::string tmp_file = file + ".tmp";
+	FILE *f = fopen(tmp_file.c_str(), "w");
+	if (f == NULL) {
+		fprintf(stderr, "can't write the catalog %s: %s\n", tmp_file.c_str(),
+				strerror(errno));
+		return false;
+	}
+	fprintf(f, "%s\n", CATALOG_HEADER.c_str());
+	for (auto it = entries.begin(); it != entries.end(); it++) {
+		const graph_entry &e = it->second;
+		fprintf(f, "%s\t%d\t%d\t%d\t%zu\t%zu\t%zu\t%s\t%s\n", e.name.c_str(),
+				e.in_safs, e.has_header, e.directed, e.num_vertices,
+				e.num_edges, e.size, e.adj_file.c_str(), e.index_file.c_str());
+	}
+	// The entries have to reach the disk before the rename, so a crash
+	// can't leave an empty catalog.
+	bool success = fflush(f) == 0 && fsync(fileno(f)) == 0;
+	success = fclose(f) == 0 && success;
+	if (success && rename(tmp_file.c_str(), file.c_str()) < 0) {
+		fprintf(stderr, "can't rename the catalog to %s: %s\n", file.c_str(),
+				strerror(errno));
+		success = false;
+	}
+	return success;
+}
+
+std::vector<graph_entry> graph_catalog::get_entries() const
+{
+	std::vector<graph_entry> ret;
+	for (auto it = entries.begin(); it != entries.end(); it++)
+		ret.push_back(it->second);
+	return ret;
+}
+
+bool graph_catalog::update(std::function<void (entry_map &)> change,
+		bool create)
+{
+	// The catalog isn't persisted without a file. A catalog that hasn't
+	// been populated from SAFS isn't persisted either; otherwise, its file
+	// would hide the graphs in SAFS from later sessions.
+	if (file.empty() || (!loaded && !create)) {
+		change(entries);
+		return false;
+	}
+
+	catalog_lock lock(file);
+	if (!lock.is_locked()) {
+		change(entries);
+		return false;
+	}
+	// Other processes may have changed the catalog since we read it.
+	// If the file is gone, the entries we have are kept.
+	load();
+	change(entries);
+	return save();
+}
+
+bool graph_catalog::add(const graph_entry &entry)
+{
+	return update([&entry](entry_map &entries) {
+			entries[entry.name] = entry;
+			});
+}
+
+bool graph_catalog::remove(const std::string &name)
+{
+	return update([&name](entry_map &entries) {
+			entries.erase(name);
+			});
+}
+
+bool graph_catalog::reset(const std::vector<graph_entry> &entries)
+{
+	loaded = update([&entries](entry_map &map) {
+			map.clear();
+			for (size_t i = 0; i < entries.size(); i++)
+				map[entries[i].name] = entries[i];
+			}, true);
+	return loaded;
+}
+
+}
@@ -0,0 +1,117 @@
+#ifndef __GRAPH_CATALOG_H__
+#define __GRAPH_CATALOG_H__
+
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fg
+{
+
+/*
+ * The information of a graph stored in SAFS or in the local filesystem.
+ */
+struct graph_entry
+{
+	std::string name;
+	// Whether the graph files are in SAFS.
+	bool in_safs;
+	// The header information is unknown for a graph found in SAFS until
+	// the graph is opened.
+	bool has_header;
+	bool directed;
+	size_t num_vertices;
+	size_t num_edges;
+	// The total bytes of the adjacency list file and the index file.
+	size_t size;
+	std::string adj_file;
+	std::string index_file;
+
+	graph_entry() {
+		in_safs = false;
+		has_header = false;
+		directed = false;
+		num_vertices = 0;
+		num_edges = 0;
+		size = 0;
+	}
+};
+
+/*
+ * The catalog keeps the information of the graphs on disks in a local file,
+ * so listing graphs and looking up a graph don't need to access
+ * the metadata of SAFS. Every change is written to the file right away.
+ * In-memory graphs that aren't stored on disks aren't in the catalog.
+ *
+ * Multiple R processes may share a catalog file. A change locks the file,
+ * reads the entries written by the other processes, applies the change and
+ * writes the file, so it doesn't overwrite the changes of the others.
+ */
+class graph_catalog
+{
+	typedef std::map<std::string, graph_entry> entry_map;
+
+	std::string file;
+	bool loaded;
+	entry_map entries;
+
+	graph_catalog(const std::string &file);
+	bool load();
+	bool save() const;
+	bool update(std::function<void (entry_map &)> change, bool create = false);
+public:
+	typedef std::shared_ptr<graph_catalog> ptr;
+
+	static ptr create(const std::string &file) {
+		return ptr(new graph_catalog(file));
+	}
+
+	/*
+	 * Whether the catalog was read from its file. A new catalog has to be
+	 * populated from the graphs in SAFS with reset(). Until then, add()
+	 * and remove() only change the catalog in memory.
+	 */
+	bool is_loaded() const {
+		return loaded;
+	}
+
+	/*
+	 * The entry is valid until the catalog is changed.
+	 */
+	const graph_entry *find(const std::string &name) const {
+		auto it = entries.find(name);
+		return it == entries.end() ? NULL : &it->second;
+	}
+
+	std::vector<graph_entry> get_entries() const;
+	bool add(const graph_entry &entry);
+	bool remove(const std::string &name);
+	/*
+	 * Replace all entries in the catalog and write it to its file.
+	 */
+	bool reset(const std::vector<graph_entry> &entries);
+};
+
+}
+
+#endif
@@ -0,0 +1,627 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+const unsigned INVALID_CLUSTER = std::numeric_limits<unsigned>::max();
+
+/*
+ * The centers of the clusters. A center is a dense row of `dim' values.
+ */
+class centers_t
+{
+	unsigned k;
+	size_t dim;
+	std::vector<double> vals;
+	std::vector<double> norms;
+public:
+	centers_t(unsigned k, size_t dim): vals(k * dim), norms(k) {
+		this->k = k;
+		this->dim = dim;
+	}
+
+	unsigned get_k() const {
+		return k;
+	}
+
+	size_t get_dim() const {
+		return dim;
+	}
+
+	double *get_center(unsigned c) {
+		return &vals[c * dim];
+	}
+
+	const double *get_center(unsigned c) const {
+		return &vals[c * dim];
+	}
+
+	const std::vector<double> &get_vals() const {
+		return vals;
+	}
+
+	void update_norms() {
+		for (unsigned c = 0; c < k; c++) {
+			const double *center = get_center(c);
+			double norm = 0;
+			for (size_t i = 0; i < dim; i++)
+				norm += center[i] * center[i];
+			norms[c] = norm;
+		}
+	}
+
+	/*
+	 * The Euclidean distance between a sparse row and a center.
+	 * `row_norm' is the squared norm of the row.
+	 */
+	double dist(const adj_list &row, double row_norm, unsigned c) const {
+		const double *center = get_center(c);
+		double dot = 0;
+		for (vsize_t i = 0; i < row.num_out; i++)
+			dot += get_val(row, i) * center[row.out_neighs[i]];
+		return sqrt(std::max(row_norm - 2 * dot + norms[c], 0.0));
+	}
+
+	/*
+	 * The Euclidean distance between two centers.
+	 */
+	double dist(unsigned c1, unsigned c2) const {
+		const double *center1 = get_center(c1);
+		const double *center2 = get_center(c2);
+		double sum = 0;
+		for (size_t i = 0; i < dim; i++)
+			sum += (center1[i] - center2[i]) * (center1[i] - center2[i]);
+		return sqrt(sum);
+	}
+
+	// A row without edge weights is a binary row.
+	static double get_val(const adj_list &row, vsize_t i) {
+		return row.out_weights ? row.out_weights[i] : 1;
+	}
+
+	static double get_norm(const adj_list &row) {
+		double norm = 0;
+		for (vsize_t i = 0; i < row.num_out; i++)
+			norm += get_val(row, i) * get_val(row, i);
+		return norm;
+	}
+};
+
+/*
+ * The sums of the rows in each cluster and the cluster sizes.
+ * Each thread accumulates the changes locally and they're merged after
+ * a scan.
+ */
+struct cluster_sums
+{
+	std::vector<double> sums;
+	std::vector<long> counts;
+
+	cluster_sums(unsigned k, size_t dim): sums(k * dim), counts(k) {
+	}
+
+	void add(const adj_list &row, unsigned c, size_t dim, int sign) {
+		double *sum = &sums[c * dim];
+		for (vsize_t i = 0; i < row.num_out; i++)
+			sum[row.out_neighs[i]] += sign * centers_t::get_val(row, i);
+		counts[c] += sign;
+	}
+
+	void merge(cluster_sums &local) {
+		for (size_t i = 0; i < sums.size(); i++)
+			sums[i] += local.sums[i];
+		for (size_t i = 0; i < counts.size(); i++)
+			counts[i] += local.counts[i];
+		std::fill(local.sums.begin(), local.sums.end(), 0);
+		std::fill(local.counts.begin(), local.counts.end(), 0);
+	}
+};
+
+class dim_visitor: public adj_visitor
+{
+	std::vector<size_t> dims;
+public:
+	dim_visitor(int num_threads): dims(num_threads) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		for (vsize_t i = 0; i < adj.num_out; i++)
+			dims[thread_id] = std::max<size_t>(dims[thread_id],
+					adj.out_neighs[i] + 1);
+	}
+
+	size_t get_dim() const {
+		return *std::max_element(dims.begin(), dims.end());
+	}
+};
+
+/*
+ * Copy the rows of the chosen vertices to the centers.
+ */
+class forgy_visitor: public adj_visitor
+{
+	const std::vector<vertex_id_t> &vids;
+	centers_t &centers;
+public:
+	forgy_visitor(const std::vector<vertex_id_t> &_vids,
+			centers_t &_centers): vids(_vids), centers(_centers) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		unsigned c = std::lower_bound(vids.begin(), vids.end(), adj.id)
+			- vids.begin();
+		double *center = centers.get_center(c);
+		for (vsize_t i = 0; i < adj.num_out; i++)
+			center[adj.out_neighs[i]] = centers_t::get_val(adj, i);
+	}
+};
+
+/*
+ * The state of a vertex in the pruned k-means. `upper' bounds the distance
+ * to the assigned center and `lower' bounds the distance to any other
+ * center.
+ */
+struct kmeans_state
+{
+	std::vector<unsigned> clusters;
+	std::vector<double> upper;
+	std::vector<double> lower;
+
+	kmeans_state(size_t num_vertices): clusters(num_vertices,
+			INVALID_CLUSTER), upper(num_vertices,
+			std::numeric_limits<double>::infinity()), lower(num_vertices) {
+		place_vertex_states(clusters);
+		place_vertex_states(upper);
+		place_vertex_states(lower);
+	}
+};
+
+/*
+ * Assign a row to its closest center. If `prune' is true, the bounds of
+ * the vertex are used to skip the distances to the other centers.
+ * A vertex that changes its cluster moves its row between the cluster
+ * sums.
+ */
+class assign_visitor: public adj_visitor
+{
+	const centers_t &centers;
+	kmeans_state &state;
+	// Half of the distance from a center to its closest center.
+	const std::vector<double> &half_min_dists;
+	std::vector<cluster_sums> &local_sums;
+	std::vector<size_t> num_pruned;
+	std::vector<size_t> num_moved;
+	bool prune;
+public:
+	assign_visitor(const centers_t &_centers, kmeans_state &_state,
+			const std::vector<double> &_half_min_dists,
+			std::vector<cluster_sums> &_local_sums): centers(_centers),
+			state(_state), half_min_dists(_half_min_dists), local_sums(
+				_local_sums), num_pruned(_local_sums.size()), num_moved(
+				_local_sums.size()) {
+		prune = false;
+	}
+
+	void set_prune(bool prune) {
+		this->prune = prune;
+	}
+
+	size_t get_num_pruned() const {
+		size_t sum = 0;
+		for (size_t i = 0; i < num_pruned.size(); i++)
+			sum += num_pruned[i];
+		return sum;
+	}
+
+	size_t get_num_moved() const {
+		size_t sum = 0;
+		for (size_t i = 0; i < num_moved.size(); i++)
+			sum += num_moved[i];
+		return sum;
+	}
+
+	void reset() {
+		std::fill(num_pruned.begin(), num_pruned.end(), 0);
+		std::fill(num_moved.begin(), num_moved.end(), 0);
+	}
+
+	void visit(const adj_list &adj, int thread_id);
+};
+
+void assign_visitor::visit(const adj_list &adj, int thread_id)
+{
+	vertex_id_t vid = adj.id;
+	double row_norm = centers_t::get_norm(adj);
+	unsigned old_c = state.clusters[vid];
+	unsigned k = centers.get_k();
+	if (prune && old_c != INVALID_CLUSTER) {
+		state.upper[vid] = centers.dist(adj, row_norm, old_c);
+		if (state.upper[vid] <= std::max(half_min_dists[old_c],
+					state.lower[vid])) {
+			num_pruned[thread_id] += k - 1;
+			return;
+		}
+	}
+
+	double best = std::numeric_limits<double>::infinity();
+	double second = std::numeric_limits<double>::infinity();
+	unsigned best_c = 0;
+	for (unsigned c = 0; c < k; c++) {
+		double d = centers.dist(adj, row_norm, c);
+		if (d < best) {
+			second = best;
+			best = d;
+			best_c = c;
+		}
+		else if (d < second)
+			second = d;
+	}
+	state.upper[vid] = best;
+	state.lower[vid] = second;
+	if (best_c != old_c) {
+		cluster_sums &sums = local_sums[thread_id];
+		if (old_c != INVALID_CLUSTER)
+			sums.add(adj, old_c, centers.get_dim(), -1);
+		sums.add(adj, best_c, centers.get_dim(), 1);
+		state.clusters[vid] = best_c;
+		num_moved[thread_id]++;
+	}
+}
+
+/*
+ * Assign a row of a mini-batch to its closest center and add it to
+ * the batch sums.
+ */
+class batch_visitor: public adj_visitor
+{
+	const centers_t &centers;
+	std::vector<cluster_sums> &local_sums;
+public:
+	batch_visitor(const centers_t &_centers,
+			std::vector<cluster_sums> &_local_sums): centers(_centers),
+			local_sums(_local_sums) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		double row_norm = centers_t::get_norm(adj);
+		double best = std::numeric_limits<double>::infinity();
+		unsigned best_c = 0;
+		for (unsigned c = 0; c < centers.get_k(); c++) {
+			double d = centers.dist(adj, row_norm, c);
+			if (d < best) {
+				best = d;
+				best_c = c;
+			}
+		}
+		local_sums[thread_id].add(adj, best_c, centers.get_dim(), 1);
+	}
+};
+
+/*
+ * Add each row to the sums of its cluster.
+ */
+class sum_visitor: public adj_visitor
+{
+	const kmeans_state &state;
+	std::vector<cluster_sums> &local_sums;
+	size_t dim;
+public:
+	sum_visitor(const kmeans_state &_state,
+			std::vector<cluster_sums> &_local_sums, size_t dim): state(_state),
+			local_sums(_local_sums) {
+		this->dim = dim;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		local_sums[thread_id].add(adj, state.clusters[adj.id], dim, 1);
+	}
+};
+
+/*
+ * Compute the centers from the cluster sums. An empty cluster keeps its
+ * center. It returns the distance each center moves.
+ */
+std::vector<double> update_centers(const cluster_sums &sums,
+		centers_t &centers)
+{
+	size_t dim = centers.get_dim();
+	std::vector<double> drifts(centers.get_k());
+#pragma omp parallel for
+	for (unsigned c = 0; c < centers.get_k(); c++) {
+		if (sums.counts[c] <= 0)
+			continue;
+		double *center = centers.get_center(c);
+		const double *sum = &sums.sums[c * dim];
+		double drift = 0;
+		for (size_t i = 0; i < dim; i++) {
+			double val = sum[i] / sums.counts[c];
+			drift += (val - center[i]) * (val - center[i]);
+			center[i] = val;
+		}
+		drifts[c] = sqrt(drift);
+	}
+	centers.update_norms();
+	return drifts;
+}
+
+double get_time(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now()
+			- start).count();
+}
+
+class kmeans_runner
+{
+	adj_scanner::ptr scanner;
+	size_t num_vertices;
+	int num_threads;
+	unsigned k;
+	centers_t centers;
+	std::vector<cluster_sums> local_sums;
+	std::default_random_engine gen;
+public:
+	kmeans_runner(adj_scanner::ptr scanner, unsigned k, size_t dim,
+			unsigned seed): centers(k, dim), local_sums(
+				scanner->get_num_threads(), cluster_sums(k, dim)), gen(seed) {
+		this->scanner = scanner;
+		this->num_vertices = scanner->get_num_vertices();
+		this->num_threads = scanner->get_num_threads();
+		this->k = k;
+	}
+
+	void init_forgy();
+	void init_random(kmeans_state &state);
+	void run_pruned(kmeans_state &state, unsigned max_iters,
+			double tolerance, kmeans_result &res);
+	void run_minibatch(size_t batch_size, unsigned max_iters,
+			double tolerance, kmeans_result &res);
+	void assign_all(kmeans_state &state);
+
+	const centers_t &get_centers() const {
+		return centers;
+	}
+};
+
+void kmeans_runner::init_forgy()
+{
+	// Pick k distinct vertices with a partial Fisher-Yates shuffle.
+	std::vector<vertex_id_t> vids(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		vids[i] = i;
+	for (unsigned i = 0; i < k; i++) {
+		std::uniform_int_distribution<size_t> dist(i, num_vertices - 1);
+		std::swap(vids[i], vids[dist(gen)]);
+	}
+	vids.resize(k);
+	std::sort(vids.begin(), vids.end());
+	forgy_visitor visitor(vids, centers);
+	scanner->scan(vids, visitor);
+	centers.update_norms();
+}
+
+/*
+ * Assign each vertex to a random cluster and use the means of
+ * the clusters as the initial centers.
+ */
+void kmeans_runner::init_random(kmeans_state &state)
+{
+	std::uniform_int_distribution<unsigned> dist(0, k - 1);
+	for (size_t i = 0; i < num_vertices; i++)
+		state.clusters[i] = dist(gen);
+	cluster_sums sums(k, centers.get_dim());
+	sum_visitor visitor(state, local_sums, centers.get_dim());
+	scanner->scan_all(visitor);
+	for (int i = 0; i < num_threads; i++)
+		sums.merge(local_sums[i]);
+	update_centers(sums, centers);
+}
+
+void kmeans_runner::run_pruned(kmeans_state &state, unsigned max_iters,
+		double tolerance, kmeans_result &res)
+{
+	cluster_sums sums(k, centers.get_dim());
+	std::vector<double> half_min_dists(k);
+	assign_visitor visitor(centers, state, half_min_dists, local_sums);
+	// The first iteration assigns all vertices from scratch.
+	std::fill(state.clusters.begin(), state.clusters.end(), INVALID_CLUSTER);
+	for (unsigned iter = 0; iter < max_iters; iter++) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<vertex_id_t> vids;
+		if (iter == 0) {
+			vids.resize(num_vertices);
+			for (size_t i = 0; i < num_vertices; i++)
+				vids[i] = i;
+		}
+		else {
+			for (size_t i = 0; i < num_vertices; i++)
+				if (state.upper[i] > std::max(
+							half_min_dists[state.clusters[i]], state.lower[i]))
+					vids.push_back(i);
+		}
+		visitor.reset();
+		visitor.set_prune(iter > 0);
+		scanner->scan(vids, visitor);
+		for (int i = 0; i < num_threads; i++)
+			sums.merge(local_sums[i]);
+
+		std::vector<double> drifts = update_centers(sums, centers);
+		// Update the bounds with the distances the centers move.
+		unsigned max_c = std::max_element(drifts.begin(), drifts.end())
+			- drifts.begin();
+		double max_drift = drifts[max_c];
+		double second_drift = 0;
+		for (unsigned c = 0; c < k; c++)
+			if (c != max_c)
+				second_drift = std::max(second_drift, drifts[c]);
+#pragma omp parallel for
+		for (size_t i = 0; i < num_vertices; i++) {
+			unsigned c = state.clusters[i];
+			state.upper[i] += drifts[c];
+			state.lower[i] -= c == max_c ? second_drift : max_drift;
+		}
+#pragma omp parallel for
+		for (unsigned c = 0; c < k; c++) {
+			double min_dist = std::numeric_limits<double>::infinity();
+			for (unsigned c2 = 0; c2 < k; c2++)
+				if (c2 != c)
+					min_dist = std::min(min_dist, centers.dist(c, c2));
+			half_min_dists[c] = min_dist / 2;
+		}
+
+		kmeans_iter_stat stat;
+		stat.num_fetched = vids.size();
+		stat.num_pruned = (num_vertices - vids.size()) * k
+			+ visitor.get_num_pruned();
+		stat.num_moved = visitor.get_num_moved();
+		stat.time = get_time(start);
+		res.stats.push_back(stat);
+		res.num_iters = iter + 1;
+		if (stat.num_moved <= tolerance * num_vertices)
+			break;
+	}
+}
+
+/*
+ * Assign all vertices to the closest centers without moving the centers.
+ */
+void kmeans_runner::assign_all(kmeans_state &state)
+{
+	std::vector<double> half_min_dists(k);
+	std::fill(state.clusters.begin(), state.clusters.end(), INVALID_CLUSTER);
+	assign_visitor visitor(centers, state, half_min_dists, local_sums);
+	scanner->scan_all(visitor);
+	for (int i = 0; i < num_threads; i++) {
+		std::fill(local_sums[i].sums.begin(), local_sums[i].sums.end(), 0);
+		std::fill(local_sums[i].counts.begin(), local_sums[i].counts.end(), 0);
+	}
+}
+
+void kmeans_runner::run_minibatch(size_t batch_size, unsigned max_iters,
+		double tolerance, kmeans_result &res)
+{
+	batch_size = std::min(batch_size, num_vertices);
+	std::vector<double> totals(k);
+	std::uniform_int_distribution<vertex_id_t> dist(0, num_vertices - 1);
+	batch_visitor visitor(centers, local_sums);
+	for (unsigned iter = 0; iter < max_iters; iter++) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<vertex_id_t> vids(batch_size);
+		for (size_t i = 0; i < batch_size; i++)
+			vids[i] = dist(gen);
+		std::sort(vids.begin(), vids.end());
+		vids.erase(std::unique(vids.begin(), vids.end()), vids.end());
+		scanner->scan(vids, visitor);
+
+		cluster_sums batch(k, centers.get_dim());
+		for (int i = 0; i < num_threads; i++)
+			batch.merge(local_sums[i]);
+		// Each center moves towards the mean of its rows in the batch
+		// with the learning rate of the per-center gradient descent.
+		size_t dim = centers.get_dim();
+		double max_drift = 0;
+		for (unsigned c = 0; c < k; c++) {
+			if (batch.counts[c] == 0)
+				continue;
+			totals[c] += batch.counts[c];
+			double rate = batch.counts[c] / totals[c];
+			double *center = centers.get_center(c);
+			const double *sum = &batch.sums[c * dim];
+			double drift = 0;
+			for (size_t i = 0; i < dim; i++) {
+				double delta = rate * (sum[i] / batch.counts[c] - center[i]);
+				center[i] += delta;
+				drift += delta * delta;
+			}
+			max_drift = std::max(max_drift, sqrt(drift));
+		}
+		centers.update_norms();
+
+		kmeans_iter_stat stat;
+		stat.num_fetched = vids.size();
+		stat.num_pruned = (num_vertices - vids.size()) * k;
+		stat.num_moved = 0;
+		stat.time = get_time(start);
+		res.stats.push_back(stat);
+		res.num_iters = iter + 1;
+		if (max_drift <= tolerance)
+			break;
+	}
+}
+
+}
+
+kmeans_result::ptr compute_kmeans(FG_graph::ptr fg, unsigned k,
+		const std::string &init, unsigned max_iters, double tolerance,
+		kmeans_method_t method, size_t batch_size, edge_weight_t weight_type,
+		unsigned seed)
+{
+	if (init != "random" && init != "forgy") {
+		fprintf(stderr, "unknown initialization: %s\n", init.c_str());
+		return kmeans_result::ptr();
+	}
+	adj_scanner::ptr scanner = adj_scanner::create(fg, weight_type);
+	size_t num_vertices = scanner->get_num_vertices();
+	if (k == 0 || k > num_vertices) {
+		fprintf(stderr, "the number of clusters has to be in [1, %ld]\n",
+				num_vertices);
+		return kmeans_result::ptr();
+	}
+	dim_visitor dvisitor(scanner->get_num_threads());
+	scanner->scan_all(dvisitor);
+	size_t dim = dvisitor.get_dim();
+
+	kmeans_result::ptr res(new kmeans_result());
+	res->num_iters = 0;
+	kmeans_runner runner(scanner, k, dim, seed);
+	kmeans_state state(num_vertices);
+	if (init == "forgy")
+		runner.init_forgy();
+	else
+		runner.init_random(state);
+
+	if (method == kmeans_method_t::PRUNED)
+		runner.run_pruned(state, max_iters, tolerance, *res);
+	else {
+		runner.run_minibatch(batch_size, max_iters, tolerance, *res);
+		runner.assign_all(state);
+	}
+
+	res->clusters.swap(state.clusters);
+	res->sizes.resize(k);
+	for (size_t i = 0; i < num_vertices; i++)
+		res->sizes[res->clusters[i]]++;
+	res->dim = dim;
+	res->centers = runner.get_centers().get_vals();
+	return res;
+}
+
+}
@@ -0,0 +1,371 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+/*
+ * The number of walks that run together. It bounds the memory for
+ * the walks in a batch.
+ */
+const size_t WALK_BATCH_SIZE = 256 * 1024;
+
+/*
+ * The number of candidates a second-order walk proposes each time it
+ * visits its current vertex. They're accepted or rejected when the walk
+ * visits its previous vertex.
+ */
+const int NUM_CANDIDATES = 8;
+
+/*
+ * The random numbers are derived from the seed, the walk, the step and
+ * the index of the draw in the step instead of a generator per thread, so
+ * the walks don't depend on the threads that run them.
+ */
+uint64_t mix64(uint64_t x)
+{
+	// The finalizer of splitmix64.
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+class walk_rng
+{
+	uint64_t seed;
+public:
+	walk_rng(uint64_t seed) {
+		this->seed = mix64(seed);
+	}
+
+	// A random number in [0, 1).
+	double get(size_t walk, int step, uint64_t draw) const {
+		uint64_t x = mix64(seed ^ walk);
+		x = mix64(x ^ (uint64_t) step);
+		x = mix64(x ^ draw);
+		return (x >> 11) * (1.0 / (1ULL << 53));
+	}
+
+	// A random integer in [0, n).
+	vsize_t get(size_t walk, int step, uint64_t draw, vsize_t n) const {
+		return std::min((vsize_t) (get(walk, step, draw) * n), n - 1);
+	}
+};
+
+// A walk at a vertex.
+typedef std::pair<vertex_id_t, size_t> walk_member_t;
+
+enum walk_state: char
+{
+	// The walk is waiting for its next vertex.
+	PENDING,
+	// The walk has proposed candidates for its next vertex.
+	PROPOSED,
+	DONE,
+};
+
+/*
+ * The walks in a batch. `walks' stores a walk in a row of `length'
+ * vertices.
+ */
+struct walk_batch
+{
+	// The ID of the first walk in the batch.
+	size_t first_walk;
+	size_t num_walks;
+	int length;
+	// The step that is being taken, i.e., the location of the next vertex.
+	int step;
+	std::vector<vertex_id_t> walks;
+	std::vector<walk_state> states;
+	std::vector<vertex_id_t> cands;
+	std::vector<double> coins;
+	// The number of times a second-order walk has proposed candidates
+	// in the step.
+	std::vector<uint32_t> rounds;
+
+	walk_batch(size_t first_walk, size_t num_walks, int length,
+			bool second_order): walks(num_walks * length, WALK_END),
+			states(num_walks, PENDING) {
+		this->first_walk = first_walk;
+		this->num_walks = num_walks;
+		this->length = length;
+		this->step = 1;
+		if (second_order) {
+			cands.resize(num_walks * NUM_CANDIDATES);
+			coins.resize(num_walks * NUM_CANDIDATES);
+			rounds.resize(num_walks);
+		}
+	}
+
+	vertex_id_t get_vertex(size_t walk, int step) const {
+		return walks[walk * length + step];
+	}
+
+	void set_next(size_t walk, vertex_id_t vid) {
+		walks[walk * length + step] = vid;
+		states[walk] = DONE;
+	}
+
+	// A walk ends at a vertex without neighbors.
+	void end(size_t walk) {
+		states[walk] = DONE;
+	}
+};
+
+/*
+ * Get the walks in the specified states at their vertices at the given
+ * step, sorted by vertex ID.
+ */
+std::vector<walk_member_t> get_members(const walk_batch &batch,
+		walk_state state, int step)
+{
+	std::vector<walk_member_t> members;
+	for (size_t i = 0; i < batch.num_walks; i++)
+		if (batch.states[i] == state)
+			members.push_back(walk_member_t(batch.get_vertex(i, step), i));
+	std::sort(members.begin(), members.end());
+	return members;
+}
+
+std::vector<vertex_id_t> get_vertices(const std::vector<walk_member_t> &members)
+{
+	std::vector<vertex_id_t> vids;
+	for (size_t i = 0; i < members.size(); i++)
+		if (vids.empty() || vids.back() != members[i].first)
+			vids.push_back(members[i].first);
+	return vids;
+}
+
+std::pair<std::vector<walk_member_t>::const_iterator,
+	std::vector<walk_member_t>::const_iterator> find_walks(
+			const std::vector<walk_member_t> &members, vertex_id_t vid)
+{
+	return std::equal_range(members.begin(), members.end(),
+			walk_member_t(vid, 0), [](const walk_member_t &m1,
+				const walk_member_t &m2) {
+			return m1.first < m2.first;
+			});
+}
+
+/*
+ * The neighbors of a vertex that a walk can move to. For BOTH_EDGES in
+ * a directed graph, they're the out-neighbors followed by
+ * the in-neighbors, like for_each_neigh.
+ */
+vsize_t get_num_steps(const adj_list &adj, edge_type type, bool directed)
+{
+	if (type == edge_type::BOTH_EDGES)
+		return directed ? adj.num_out + adj.num_in : adj.num_out;
+	else
+		return adj.get_num_neighs(type);
+}
+
+vertex_id_t get_step(const adj_list &adj, edge_type type, vsize_t idx)
+{
+	if (type == edge_type::BOTH_EDGES)
+		return idx < adj.num_out ? adj.out_neighs[idx]
+			: adj.in_neighs[idx - adj.num_out];
+	else
+		return adj.get_neighs(type)[idx];
+}
+
+/*
+ * Whether a walk can move from the vertex to `vid'. The neighbor lists
+ * are sorted by vertex ID.
+ */
+bool is_step(const adj_list &adj, edge_type type, bool directed,
+		vertex_id_t vid)
+{
+	if (type == edge_type::BOTH_EDGES) {
+		return std::binary_search(adj.out_neighs, adj.out_neighs + adj.num_out,
+				vid) || (directed && std::binary_search(adj.in_neighs,
+					adj.in_neighs + adj.num_in, vid));
+	}
+	else {
+		const vertex_id_t *neighs = adj.get_neighs(type);
+		return std::binary_search(neighs, neighs + adj.get_num_neighs(type),
+				vid);
+	}
+}
+
+/*
+ * Visit the current vertices of the walks. A first-order walk and
+ * the first step of a walk move to a random neighbor. A second-order walk
+ * proposes candidates drawn uniformly from the neighbors together with
+ * coins for the rejection sampling. Each proposal of a walk in a step
+ * takes its own draws.
+ */
+class walk_visitor: public adj_visitor
+{
+	edge_type type;
+	bool directed;
+	bool second_order;
+	const std::vector<walk_member_t> &members;
+	walk_batch &batch;
+	const walk_rng &rng;
+public:
+	walk_visitor(edge_type type, bool directed, bool second_order,
+			const std::vector<walk_member_t> &_members, walk_batch &_batch,
+			const walk_rng &_rng): members(_members), batch(_batch),
+			rng(_rng) {
+		this->type = type;
+		this->directed = directed;
+		this->second_order = second_order;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		vsize_t num_steps = get_num_steps(adj, type, directed);
+		int step = batch.step;
+		auto range = find_walks(members, adj.id);
+		for (auto it = range.first; it != range.second; it++) {
+			size_t walk = it->second;
+			size_t walk_id = batch.first_walk + walk;
+			if (num_steps == 0)
+				batch.end(walk);
+			else if (!second_order || step == 1)
+				batch.set_next(walk, get_step(adj, type,
+							rng.get(walk_id, step, 0, num_steps)));
+			else {
+				uint64_t draw = (uint64_t) batch.rounds[walk]++
+					* NUM_CANDIDATES * 2;
+				for (int i = 0; i < NUM_CANDIDATES; i++) {
+					batch.cands[walk * NUM_CANDIDATES + i] = get_step(adj,
+							type, rng.get(walk_id, step, draw++, num_steps));
+					batch.coins[walk * NUM_CANDIDATES + i] = rng.get(walk_id,
+							step, draw++);
+				}
+				batch.states[walk] = PROPOSED;
+			}
+		}
+	}
+};
+
+/*
+ * Visit the previous vertices of the walks that have proposed candidates.
+ * node2vec weights a candidate by 1/p if it's the previous vertex, by 1
+ * if it's a neighbor of the previous vertex and by 1/q otherwise.
+ * The first candidate that passes its coin is accepted. If all of them
+ * fail, the walk proposes again.
+ */
+class accept_visitor: public adj_visitor
+{
+	edge_type type;
+	bool directed;
+	double return_weight;
+	double out_weight;
+	double max_weight;
+	const std::vector<walk_member_t> &members;
+	walk_batch &batch;
+public:
+	accept_visitor(edge_type type, bool directed, double p, double q,
+			const std::vector<walk_member_t> &_members,
+			walk_batch &_batch): members(_members), batch(_batch) {
+		this->type = type;
+		this->directed = directed;
+		this->return_weight = 1 / p;
+		this->out_weight = 1 / q;
+		this->max_weight = std::max(std::max(return_weight, out_weight), 1.0);
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		auto range = find_walks(members, adj.id);
+		for (auto it = range.first; it != range.second; it++) {
+			size_t walk = it->second;
+			batch.states[walk] = PENDING;
+			for (int i = 0; i < NUM_CANDIDATES; i++) {
+				vertex_id_t cand = batch.cands[walk * NUM_CANDIDATES + i];
+				double weight;
+				if (cand == adj.id)
+					weight = return_weight;
+				else if (is_step(adj, type, directed, cand))
+					weight = 1;
+				else
+					weight = out_weight;
+				if (batch.coins[walk * NUM_CANDIDATES + i] * max_weight
+						< weight) {
+					batch.set_next(walk, cand);
+					break;
+				}
+			}
+		}
+	}
+};
+
+}
+
+void generate_random_walks(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &starts, const walk_options &opts,
+		std::function<void (const vertex_id_t *, size_t)> consume)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	bool second_order = opts.p != 1 || opts.q != 1;
+	walk_rng rng(opts.seed);
+
+	size_t num_walks = starts.size() * opts.walks_per_vertex;
+	for (size_t batch_start = 0; batch_start < num_walks;
+			batch_start += WALK_BATCH_SIZE) {
+		walk_batch batch(batch_start, std::min(WALK_BATCH_SIZE,
+					num_walks - batch_start), opts.length, second_order);
+		// Walk i starts from starts[i % starts.size()], so each round of
+		// walks covers all start vertices.
+		for (size_t i = 0; i < batch.num_walks; i++)
+			batch.walks[i * opts.length]
+				= starts[(batch_start + i) % starts.size()];
+
+		for (; batch.step < opts.length; batch.step++) {
+			// The walks that ended in the previous steps stay done.
+			for (size_t i = 0; i < batch.num_walks; i++)
+				if (batch.get_vertex(i, batch.step - 1) != WALK_END)
+					batch.states[i] = PENDING;
+			std::fill(batch.rounds.begin(), batch.rounds.end(), 0);
+			// A second-order walk repeats until one of its candidates is
+			// accepted. The adjacency lists of all walks at the same step
+			// are fetched in a scan.
+			while (true) {
+				std::vector<walk_member_t> members = get_members(batch,
+						PENDING, batch.step - 1);
+				if (members.empty())
+					break;
+				walk_visitor visitor(opts.type, scanner->is_directed(),
+						second_order, members, batch, rng);
+				scanner->scan(get_vertices(members), visitor);
+
+				members = get_members(batch, PROPOSED, batch.step - 2);
+				if (members.empty())
+					continue;
+				accept_visitor accept(opts.type, scanner->is_directed(),
+						opts.p, opts.q, members, batch);
+				scanner->scan(get_vertices(members), accept);
+			}
+		}
+		consume(batch.walks.data(), batch.num_walks);
+	}
+}
+
+}
@@ -17,6 +17,10 @@
  * limitations under the License.
  */
 
+#include <unistd.h>
+
+#include <chrono>
+#include <limits>
 #include <unordered_map>
 #include <Rcpp.h>
 
@@ -39,6 +43,12 @@
 #include "col_vec.h"
 
 #include "rutils.h"
+#include "graph_algs.h"
+#include "graph_builder.h"
+#include "graph_catalog.h"
+#include "checkpoint.h"
+#include "column_file.h"
+#include "shm_graph.h"
 
 using namespace safs;
 using namespace fg;
@@ -58,6 +68,8 @@ class graph_ref
 	in_mem_graph::ptr g;
 	vertex_index::ptr index;
 	std::string name;
+	// The adjacency cache built on this graph.
+	adj_cache::ptr cache;
 	int count;
 public:
 	graph_ref(in_mem_graph::ptr g, vertex_index::ptr index,
@@ -73,7 +85,21 @@ public:
 	}
 
 	FG_graph::ptr get_graph() {
-		return FG_graph::create(g, index, name, configs);
+		FG_graph::ptr fg = FG_graph::create(g, index, name, configs);
+		attach_adj_cache(fg, cache);
+		return fg;
+	}
+
+	void set_cache(adj_cache::ptr cache) {
+		this->cache = cache;
+	}
+
+	/*
+	 * Replace the data of the graph with another copy of the same graph.
+	 */
+	void set_data(in_mem_graph::ptr g, vertex_index::ptr index) {
+		this->g = g;
+		this->index = index;
 	}
 
 	const std::string &get_name() const {
@@ -97,6 +123,12 @@ static graph_map_t graphs;
 
 static bool standalone = true;
 
+/*
+ * The catalog of the graphs stored in SAFS or in the local filesystem.
+ * It isn't backed by a file until R_FG_set_catalog is called.
+ */
+static graph_catalog::ptr catalog = graph_catalog::create("");
+
 static std::pair<std::string, std::string> get_graph_files(
 		const std::string &graph_name)
 {
@@ -106,7 +138,14 @@ static std::pair<std::string, std::string> get_graph_files(
 }
 
 /*
- * Get a FG_graph for the specified graph.
+ * The adjacency caches of the graphs in SAFS or in the local filesystem.
+ * The cache of an in-memory graph is kept in its graph_ref.
+ */
+static std::unordered_map<std::string, adj_cache::ptr> adj_caches;
+
+/*
+ * Get a FG_graph for the specified graph. The adjacency cache of the graph
+ * is attached to the FG_graph, so the kernels that run on it use the cache.
  */
 FG_graph::ptr R_FG_get_graph(SEXP pgraph)
 {
@@ -122,11 +161,42 @@ FG_graph::ptr R_FG_get_graph(SEXP pgraph)
 		return FG_graph::ptr();
 	}
 	else {
-		auto graph_files = get_graph_files(graph["name"]);
-		return FG_graph::create(graph_files.first, graph_files.second, configs);
+		std::string graph_name = graph["name"];
+		auto graph_files = get_graph_files(graph_name);
+		const graph_entry *entry = catalog->find(graph_name);
+		if (entry) {
+			graph_files.first = entry->adj_file;
+			graph_files.second = entry->index_file;
+		}
+		FG_graph::ptr fg = FG_graph::create(graph_files.first,
+				graph_files.second, configs);
+		auto cache_it = adj_caches.find(graph_name);
+		if (cache_it != adj_caches.end())
+			attach_adj_cache(fg, cache_it->second);
+		return fg;
 	}
 }
 
+static bool report_progress = false;
+
+/*
+ * Print the progress of a kernel at most once a second.
+ */
+static void print_scan_progress(const scan_progress &progress)
+{
+	static auto last = std::chrono::steady_clock::now();
+	if (!report_progress)
+		return;
+	auto now = std::chrono::steady_clock::now();
+	if (std::chrono::duration<double>(now - last).count() < 1)
+		return;
+	last = now;
+	Rprintf("step %ld: %ld active vertices, %ld vertices and %ld edges processed\n",
+			progress.num_steps, progress.num_active, progress.num_vertices,
+			progress.num_edges);
+	R_FlushConsole();
+}
+
 /**
  * Initialize FlashGraph.
  */
@@ -150,6 +220,12 @@ RcppExport SEXP R_FG_init(SEXP pconf)
 		configs = config_map::create();
 
 	standalone = !is_safs_init();
+	// Rcpp::checkUserInterrupt() throws an exception on Ctrl-C, which
+	// unwinds the kernel and is turned into an R interrupt by END_RCPP.
+	set_interrupt_handler([]() {
+			Rcpp::checkUserInterrupt();
+			});
+	set_progress_handler(print_scan_progress);
 	bool fg_success;
 	try {
 		graph_engine::init_flash_graph(configs);
@@ -202,7 +278,8 @@ RcppExport SEXP R_FG_destroy()
 }
 
 /*
- * This search in memory first, and then searches in SAFS.
+ * This search in memory first, and then searches in the catalog.
+ * It searches in SAFS only if the catalog hasn't been loaded.
  */
 static bool exist_graph(std::string &graph_name)
 {
@@ -211,6 +288,15 @@ static bool exist_graph(std::string &graph_name)
 	if (it != graphs.end())
 		return true;
 
+	const graph_entry *entry = catalog->find(graph_name);
+	if (entry && entry->in_safs)
+		return !standalone;
+	else if (entry)
+		return safs::file_exist(entry->adj_file)
+			&& safs::file_exist(entry->index_file);
+	else if (catalog->is_loaded())
+		return false;
+
 	// If FlashGraphR runs in the standalone mode, we can't search in SAFS.
 	if (standalone)
 		return false;
@@ -309,46 +395,255 @@ static std::string extract_graph_name(const std::string &file_name)
 		return file_name.substr(0, pos);
 }
 
-/**
- * This lists all graphs that have been loaded to FlashGraphR.
+static size_t get_file_size(const std::string &file, bool in_safs)
+{
+	if (in_safs) {
+		safs_file f(get_sys_RAID_conf(), file);
+		return f.exist() ? f.get_size() : 0;
+	}
+	else {
+		native_file f(file);
+		return f.exist() ? f.get_size() : 0;
+	}
+}
+
+/*
+ * Add a graph stored in files to the catalog.
  */
-RcppExport SEXP R_FG_list_graphs()
+static void catalog_graph(FG_graph::ptr fg, const std::string &graph_name,
+		const std::string &adj_file, const std::string &index_file,
+		bool in_safs)
 {
-	// Get all graphs in memory.
-	std::map<std::string, bool> graph_names;
-	for (graph_map_t::const_iterator it = graphs.begin();
-			it != graphs.end(); it++) {
-		graph_names.insert(std::pair<std::string, bool>(it->first, true));
+	graph_entry entry;
+	entry.name = graph_name;
+	entry.in_safs = in_safs;
+	graph_header header = fg->get_graph_header();
+	entry.has_header = true;
+	entry.directed = header.is_directed_graph();
+	entry.num_vertices = header.get_num_vertices();
+	entry.num_edges = header.get_num_edges();
+	entry.size = get_file_size(adj_file, in_safs)
+		+ get_file_size(index_file, in_safs);
+	entry.adj_file = adj_file;
+	entry.index_file = index_file;
+	catalog->add(entry);
+}
+
+/*
+ * Rebuild the catalog from the graphs in SAFS. The graphs in the local
+ * filesystem are kept if their files still exist. This is the only place
+ * that scans SAFS for graphs.
+ *
+ * SAFS can't be scanned in the standalone mode, so the graphs in SAFS are
+ * kept as they are, and a catalog that hasn't been built from SAFS stays
+ * unloaded and isn't written to its file. It's built when the catalog is
+ * set or listed after SAFS is initialized.
+ */
+static void rebuild_catalog(const std::vector<graph_entry> &old_entries)
+{
+	std::map<std::string, graph_entry> old_map;
+	std::vector<graph_entry> entries;
+	BOOST_FOREACH(graph_entry entry, old_entries) {
+		if (entry.in_safs)
+			old_map[entry.name] = entry;
+		else if (safs::file_exist(entry.adj_file)
+				&& safs::file_exist(entry.index_file))
+			entries.push_back(entry);
 	}
 
-	// Get all graphs in SAFS.
-	if (!standalone) {
+	if (standalone) {
+		for (auto it = old_map.begin(); it != old_map.end(); it++)
+			entries.push_back(it->second);
+		if (catalog->is_loaded())
+			catalog->reset(entries);
+		else {
+			// The entries are only kept in memory.
+			BOOST_FOREACH(graph_entry entry, entries)
+				catalog->add(entry);
+		}
+		return;
+	}
+	else {
 		std::set<std::string> files;
 		get_all_safs_files(files);
-
 		BOOST_FOREACH(std::string file, files) {
 			std::string graph_name = extract_graph_name(file);
-			if (!graph_name.empty())
-				graph_names.insert(std::pair<std::string, bool>(
-							graph_name, false));
+			auto graph_files = get_graph_files(graph_name);
+			// We only need to look at a graph once.
+			if (graph_name.empty() || file != graph_files.first
+					|| files.find(graph_files.second) == files.end())
+				continue;
+
+			graph_entry entry;
+			// We don't open the graph to read its header here. It's cached
+			// when the graph is opened.
+			auto it = old_map.find(graph_name);
+			if (it != old_map.end())
+				entry = it->second;
+			entry.name = graph_name;
+			entry.in_safs = true;
+			entry.adj_file = graph_files.first;
+			entry.index_file = graph_files.second;
+			entry.size = get_file_size(graph_files.first, true)
+				+ get_file_size(graph_files.second, true);
+			entries.push_back(entry);
 		}
 	}
+	catalog->reset(entries);
+}
+
+/**
+ * This sets the file of the graph catalog. If the file doesn't exist,
+ * the catalog is built from the graphs in SAFS.
+ */
+RcppExport SEXP R_FG_set_catalog(SEXP pfile)
+{
+	std::string file = CHAR(STRING_ELT(pfile, 0));
+	graph_catalog::ptr old_catalog = catalog;
+	catalog = graph_catalog::create(file);
+	// The graphs cataloged in memory before the catalog could be built
+	// are kept.
+	if (!catalog->is_loaded())
+		rebuild_catalog(old_catalog->is_loaded()
+				? std::vector<graph_entry>() : old_catalog->get_entries());
+	Rcpp::LogicalVector res(1);
+	res[0] = catalog->is_loaded();
+	return res;
+}
+
+/**
+ * This lists all graphs that have been loaded to FlashGraphR and all graphs
+ * in the catalog. The information of the graphs on disks comes from
+ * the catalog, so it doesn't access SAFS unless we refresh the catalog.
+ */
+RcppExport SEXP R_FG_list_graphs(SEXP prefresh)
+{
+	if (LOGICAL(prefresh)[0] || !catalog->is_loaded())
+		rebuild_catalog(catalog->get_entries());
+
+	// Get all graphs in memory.
+	std::map<std::string, graph_entry> entries;
+	for (graph_map_t::const_iterator it = graphs.begin();
+			it != graphs.end(); it++) {
+		FG_graph::ptr fg = it->second->get_graph();
+		graph_header header = fg->get_graph_header();
+		graph_entry entry;
+		entry.name = it->first;
+		entry.has_header = true;
+		entry.directed = header.is_directed_graph();
+		entry.num_vertices = header.get_num_vertices();
+		entry.num_edges = header.get_num_edges();
+		entry.size = fg->get_graph_data()->get_graph_size()
+			+ fg->get_index_data()->get_index_size();
+		entries[it->first] = entry;
+	}
+	std::set<std::string> in_mem_names;
+	for (auto it = entries.begin(); it != entries.end(); it++)
+		in_mem_names.insert(it->first);
+
+	// Get all graphs in the catalog.
+	BOOST_FOREACH(graph_entry entry, catalog->get_entries()) {
+		if (entries.find(entry.name) == entries.end()
+				&& (!entry.in_safs || !standalone))
+			entries[entry.name] = entry;
+	}
 
-	Rcpp::CharacterVector names;
-	Rcpp::LogicalVector in_mem;
-	typedef std::pair<std::string, bool> graph_value_t;
-	BOOST_FOREACH(graph_value_t graph, graph_names) {
-		if (graph.second) {
-			names.push_back(graph.first);
-			in_mem.push_back(graph.second);
+	size_t num_graphs = entries.size();
+	Rcpp::CharacterVector names(num_graphs);
+	Rcpp::LogicalVector in_mem(num_graphs);
+	Rcpp::LogicalVector directed(num_graphs);
+	Rcpp::NumericVector vcount(num_graphs);
+	Rcpp::NumericVector ecount(num_graphs);
+	Rcpp::NumericVector size(num_graphs);
+	size_t i = 0;
+	for (auto it = entries.begin(); it != entries.end(); it++, i++) {
+		const graph_entry &entry = it->second;
+		names[i] = entry.name;
+		in_mem[i] = in_mem_names.find(entry.name) != in_mem_names.end();
+		if (entry.has_header) {
+			directed[i] = entry.directed;
+			vcount[i] = entry.num_vertices;
+			ecount[i] = entry.num_edges;
 		}
-		else if (exist_graph(graph.first)) {
-			names.push_back(graph.first);
-			in_mem.push_back(graph.second);
+		else {
+			directed[i] = NA_LOGICAL;
+			vcount[i] = NA_REAL;
+			ecount[i] = NA_REAL;
 		}
+		size[i] = entry.size;
 	}
 	return Rcpp::DataFrame::create(Rcpp::Named("name") = names,
-			Rcpp::Named("in-mem") = in_mem);
+			Rcpp::Named("in-mem") = in_mem, Rcpp::Named("directed") = directed,
+			Rcpp::Named("vcount") = vcount, Rcpp::Named("ecount") = ecount,
+			Rcpp::Named("size") = size);
+}
+
+/*
+ * Build the adjacency cache of a graph within `pbudget' bytes.
+ * A budget of 0 removes the cache.
+ */
+RcppExport SEXP R_FG_set_adj_cache(SEXP pgraph, SEXP pbudget, SEXP pattr_type)
+{
+BEGIN_RCPP
+	Rcpp::List graph(pgraph);
+	std::string name = graph["name"];
+	size_t budget = REAL(pbudget)[0];
+	edge_weight_t weight_type = get_edge_weight_type(
+			CHAR(STRING_ELT(pattr_type, 0)));
+	graph_ref *ref = NULL;
+	if (graph.containsElementNamed("pointer"))
+		ref = (graph_ref *) R_ExternalPtrAddr(graph["pointer"]);
+	// The old cache shouldn't take memory while the new one is built.
+	if (ref)
+		ref->set_cache(adj_cache::ptr());
+	else
+		adj_caches.erase(name);
+	Rcpp::List ret;
+	if (budget == 0) {
+		ret["vertices"] = 0.0;
+		ret["bytes"] = 0.0;
+		return ret;
+	}
+	FG_graph::ptr fg = R_FG_get_graph(pgraph);
+	adj_cache::ptr cache = adj_cache::create(fg, budget, weight_type);
+	if (ref)
+		ref->set_cache(cache);
+	else
+		adj_caches[name] = cache;
+	ret["vertices"] = (double) cache->get_num_cached();
+	ret["bytes"] = (double) cache->get_size();
+	return ret;
+END_RCPP
+}
+
+RcppExport SEXP R_FG_set_checkpoint(SEXP pfile, SEXP pinterval)
+{
+	// An empty file name turns off checkpointing.
+	std::string file = CHAR(STRING_ELT(pfile, 0));
+	set_checkpoint_options(file, REAL(pinterval)[0]);
+	return R_NilValue;
+}
+
+/*
+ * Load a checkpoint so the next run of its kernel on the graph resumes
+ * from it. It returns the name of the kernel.
+ */
+RcppExport SEXP R_FG_load_checkpoint(SEXP pgraph, SEXP pfile)
+{
+	std::string file = CHAR(STRING_ELT(pfile, 0));
+	checkpoint::ptr ckpt = checkpoint::load(file);
+	if (ckpt == NULL)
+		return R_NilValue;
+	FG_graph::ptr fg = R_FG_get_graph(pgraph);
+	if (!ckpt->is_for(ckpt->get_kernel(), fg)) {
+		fprintf(stderr, "checkpoint %s isn't taken on the graph\n",
+				file.c_str());
+		return R_NilValue;
+	}
+	set_resume_checkpoint(ckpt);
+	Rcpp::CharacterVector kernel(1);
+	kernel[0] = ckpt->get_kernel();
+	return kernel;
 }
 
 RcppExport SEXP R_FG_set_log_level(SEXP plevel)
@@ -375,6 +670,47 @@ RcppExport SEXP R_FG_set_log_level(SEXP plevel)
 	return R_NilValue;
 }
 
+RcppExport SEXP R_FG_set_progress(SEXP pverbose)
+{
+	report_progress = LOGICAL(pverbose)[0];
+	return R_NilValue;
+}
+
+RcppExport SEXP R_FG_get_progress()
+{
+	const scan_progress &progress = get_scan_progress();
+	Rcpp::List ret;
+	ret["steps"] = (double) progress.num_steps;
+	ret["active"] = (double) progress.num_active;
+	ret["vertices"] = (double) progress.num_vertices;
+	ret["edges"] = (double) progress.num_edges;
+	ret["bytes"] = (double) progress.num_bytes;
+	ret["time"] = progress.time;
+	ret["cache.hits"] = (double) progress.num_cache_hits;
+	ret["cache.misses"] = (double) progress.num_cache_misses;
+	ret["cache.saved"] = (double) progress.cache_bytes_saved;
+
+	const std::vector<node_traffic> &traffic = get_node_traffic();
+	Rcpp::IntegerVector nodes(traffic.size());
+	Rcpp::NumericVector vertices(traffic.size());
+	Rcpp::NumericVector edges(traffic.size());
+	Rcpp::NumericVector bytes(traffic.size());
+	Rcpp::NumericVector bandwidth(traffic.size());
+	for (size_t i = 0; i < traffic.size(); i++) {
+		nodes[i] = i;
+		vertices[i] = traffic[i].num_vertices;
+		edges[i] = traffic[i].num_edges;
+		bytes[i] = traffic[i].num_bytes;
+		// In MB/s.
+		bandwidth[i] = progress.time > 0
+			? traffic[i].num_bytes / progress.time / 1024 / 1024 : 0;
+	}
+	ret["nodes"] = Rcpp::DataFrame::create(Named("node", nodes),
+			Named("vertices", vertices), Named("edges", edges),
+			Named("bytes", bytes), Named("bandwidth", bandwidth));
+	return ret;
+}
+
 static void fg_clean_graph(SEXP p)
 {
 	graph_ref *ref = (graph_ref *) R_ExternalPtrAddr(p);
@@ -382,15 +718,11 @@ static void fg_clean_graph(SEXP p)
 	if (ref->get_counts() > 1)
 		return;
 
+	// The graph may have been deleted from the graph table.
 	auto it = graphs.find(ref->get_name());
-	if (it == graphs.end()) {
-		fprintf(stderr, "graph %s doesn't exist\n", ref->get_name().c_str());
-	}
-	else {
-		// If the graph is still registered in the graph table.
-		if (it->second == ref)
-			graphs.erase(it);
-	}
+	// If the graph is still registered in the graph table.
+	if (it != graphs.end() && it->second == ref)
+		graphs.erase(it);
 
 	// There are no R objects referencing this graph now.
 	printf("delete graph %s\n", ref->get_name().c_str());
@@ -457,6 +789,33 @@ static SEXP create_FGR_obj(FG_graph::ptr graph, const std::string &graph_name)
 	return ret;
 }
 
+/*
+ * Create an R object for a graph in SAFS from its cached header without
+ * opening the graph.
+ */
+static SEXP create_FGR_obj(const graph_entry &entry)
+{
+	Rcpp::List ret;
+	ret["name"] = Rcpp::String(entry.name);
+
+	Rcpp::LogicalVector directed(1);
+	directed[0] = entry.directed;
+	ret["directed"] = directed;
+
+	Rcpp::NumericVector vcount(1);
+	vcount[0] = entry.num_vertices;
+	ret["vcount"] = vcount;
+
+	Rcpp::NumericVector ecount(1);
+	ecount[0] = entry.num_edges;
+	ret["ecount"] = ecount;
+
+	Rcpp::LogicalVector in_mem(1);
+	in_mem[0] = false;
+	ret["in.mem"] = in_mem;
+	return ret;
+}
+
 graph_ref *register_in_mem_graph(FG_graph::ptr fg,
 		const std::string &graph_name)
 {
@@ -486,6 +845,8 @@ RcppExport SEXP R_FG_load_graph_adj(SEXP pgraph_name, SEXP pgraph_file,
 	std::string graph_name = CHAR(STRING_ELT(pgraph_name, 0));
 	std::string graph_file = CHAR(STRING_ELT(pgraph_file, 0));
 	std::string index_file = CHAR(STRING_ELT(pindex_file, 0));
+	// The graph replaces the one with the same name, whose cache is stale.
+	adj_caches.erase(graph_name);
 
 	FG_graph::ptr fg;
 	try {
@@ -494,6 +855,9 @@ RcppExport SEXP R_FG_load_graph_adj(SEXP pgraph_name, SEXP pgraph_file,
 		fprintf(stderr, "%s\n", e.what());
 		return R_NilValue;
 	}
+	// The graph files are in SAFS if they aren't in the local filesystem.
+	catalog_graph(fg, graph_name, graph_file, index_file,
+			!safs::file_exist(graph_file));
 	graph_ref *ref = register_in_mem_graph(fg, graph_name);
 	if (ref)
 		return create_FGR_obj(ref);
@@ -517,6 +881,8 @@ RcppExport SEXP R_FG_export_graph(SEXP pgraph, SEXP pgraph_file, SEXP pindex_fil
 		vertex_index::ptr index_data = fg->get_index_data();
 		graph_data->dump(graph_file);
 		index_data->dump(index_file);
+		Rcpp::List graph(pgraph);
+		catalog_graph(fg, graph["name"], graph_file, index_file, false);
 		ret[0] = true;
 	}
 	return ret;
@@ -576,11 +942,106 @@ RcppExport SEXP R_FG_load_graph_el_df(SEXP pgraph_name, SEXP pedge_lists,
 		return create_FGR_obj(fg, graph_name);
 }
 
+/*
+ * Load a graph file built in `tmp_dir' to SAFS and delete the local copy.
+ */
+static bool load_to_safs(const std::string &local_file,
+		const std::string &safs_name)
+{
+	safs_file f(get_sys_RAID_conf(), safs_name);
+	bool success = f.load_data(local_file);
+	if (!success)
+		fprintf(stderr, "can't load %s to SAFS\n", safs_name.c_str());
+	unlink(local_file.c_str());
+	return success;
+}
+
+/*
+ * Build a graph from an edge list file in external memory. The sorted runs
+ * are written to `tmp_dir'. The graph is stored in SAFS if `out_dir' is
+ * empty; otherwise, its files are written to `out_dir' in the local
+ * filesystem.
+ */
+static SEXP load_graph_el_ext_mem(const std::string &graph_name,
+		const std::string &graph_file, bool directed, const std::string &delim,
+		const std::string &attr_type, size_t mem_size,
+		const std::string &tmp_dir, const std::string &out_dir)
+{
+	bool in_safs = out_dir.empty();
+	if (in_safs && standalone) {
+		fprintf(stderr,
+				"an output directory is required to store a graph without SAFS\n");
+		return R_NilValue;
+	}
+	auto graph_files = get_graph_files(graph_name);
+	if (in_safs) {
+		safs_file adj(get_sys_RAID_conf(), graph_files.first);
+		safs_file index(get_sys_RAID_conf(), graph_files.second);
+		if (adj.exist() || index.exist()) {
+			fprintf(stderr, "graph %s already exists in SAFS\n",
+					graph_name.c_str());
+			return R_NilValue;
+		}
+	}
+
+	ext_build_options opts;
+	opts.directed = directed;
+	opts.delim = delim;
+	opts.attr_type = attr_type;
+	opts.mem_size = mem_size;
+	opts.tmp_dir = tmp_dir;
+	opts.num_threads = graph_conf.get_num_threads();
+	// The graph files are built in the temporary directory before they're
+	// loaded to SAFS.
+	std::string build_dir = in_safs ? tmp_dir : out_dir;
+	std::string adj_file = build_dir + "/" + graph_files.first;
+	std::string index_file = build_dir + "/" + graph_files.second;
+	if (!build_graph_ext_mem(std::vector<std::string>(1, graph_file),
+				adj_file, index_file, opts)) {
+		if (in_safs) {
+			unlink(adj_file.c_str());
+			unlink(index_file.c_str());
+		}
+		return R_NilValue;
+	}
+	if (in_safs) {
+		bool success = load_to_safs(adj_file, graph_files.first);
+		success = load_to_safs(index_file, graph_files.second) && success;
+		if (!success) {
+			// A graph with only one of its files in SAFS can't be used.
+			safs_file adj(get_sys_RAID_conf(), graph_files.first);
+			safs_file index(get_sys_RAID_conf(), graph_files.second);
+			if (adj.exist())
+				adj.delete_file();
+			if (index.exist())
+				index.delete_file();
+			return R_NilValue;
+		}
+		adj_file = graph_files.first;
+		index_file = graph_files.second;
+	}
+
+	FG_graph::ptr fg;
+	try {
+		fg = FG_graph::create(adj_file, index_file, configs);
+	} catch(std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return R_NilValue;
+	}
+	catalog_graph(fg, graph_name, adj_file, index_file, in_safs);
+	graph_ref *ref = register_in_mem_graph(fg, graph_name);
+	if (ref)
+		return create_FGR_obj(ref);
+	else
+		return create_FGR_obj(fg, graph_name);
+}
+
 /*
  * Load a graph from edge lists in a file.
  */
 RcppExport SEXP R_FG_load_graph_el(SEXP pgraph_name, SEXP pgraph_file,
-		SEXP pdirected, SEXP pin_mem, SEXP pdelim, SEXP pattr_type)
+		SEXP pdirected, SEXP pin_mem, SEXP pdelim, SEXP pattr_type,
+		SEXP pmem_size, SEXP ptmp_dir, SEXP pout_dir)
 {
 	Rcpp::LogicalVector res(1);
 	std::string graph_name = CHAR(STRING_ELT(pgraph_name, 0));
@@ -590,16 +1051,21 @@ RcppExport SEXP R_FG_load_graph_el(SEXP pgraph_name, SEXP pgraph_file,
 	std::string delim = CHAR(STRING_ELT(pdelim, 0));
 	std::string attr_type = CHAR(STRING_ELT(pattr_type, 0));
 
-	if (!in_mem && !is_safs_init()) {
-		fprintf(stderr, "SAFS isn't initialized\n");
-		return R_NilValue;
-	}
-
 	native_file f(graph_file);
 	if (!f.exist()) {
 		fprintf(stderr, "edge list file %s doesn't exist\n", graph_file.c_str());
 		return R_NilValue;
 	}
+	// The graph replaces the one with the same name, whose cache is stale.
+	adj_caches.erase(graph_name);
+
+	// Construct the graph in external memory. The graph is stored in SAFS
+	// and opened from there, so it doesn't have to fit in memory. Without
+	// SAFS, the graph files are written to the output directory.
+	if (!in_mem)
+		return load_graph_el_ext_mem(graph_name, graph_file, directed, delim,
+				attr_type, REAL(pmem_size)[0], CHAR(STRING_ELT(ptmp_dir, 0)),
+				R_is_null(pout_dir) ? "" : CHAR(STRING_ELT(pout_dir, 0)));
 
 	std::vector<std::string> edge_list_files(1);
 	edge_list_files[0] = graph_file;
@@ -629,25 +1095,159 @@ RcppExport SEXP R_FG_get_graph_obj(SEXP pgraph)
 	}
 
 	auto it = graphs.find(graph_name);
-	// If the graph exist, but it's not in the graph table. It's in SAFS.
-	if (it == graphs.end()) {
+	if (it != graphs.end())
+		return create_FGR_obj(it->second);
+
+	// If the graph exist, but it's not in the graph table. It's in SAFS
+	// or in the local filesystem.
+	auto graph_files = get_graph_files(graph_name);
+	bool in_safs = true;
+	const graph_entry *entry = catalog->find(graph_name);
+	if (entry) {
+		// A graph in SAFS is opened when we run an algorithm on it,
+		// so we don't need to open it here if we know its header.
+		if (entry->in_safs && entry->has_header
+				&& !graph_conf.use_in_mem_graph())
+			return create_FGR_obj(*entry);
+		graph_files.first = entry->adj_file;
+		graph_files.second = entry->index_file;
+		in_safs = entry->in_safs;
+	}
+	try {
+		FG_graph::ptr fg = FG_graph::create(graph_files.first,
+				graph_files.second, configs);
+		catalog_graph(fg, graph_name, graph_files.first, graph_files.second,
+				in_safs);
+		graph_ref *ref = register_in_mem_graph(fg, graph_name);
+		if (ref)
+			return create_FGR_obj(ref);
+		else
+			return create_FGR_obj(fg, graph_name);
+	} catch(wrong_format &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return R_NilValue;
+	}
+}
+
+/*
+ * Delete a graph from memory, SAFS and the catalog. The files of a graph
+ * in the local filesystem are kept.
+ */
+RcppExport SEXP R_FG_delete_graph(SEXP pgraph, SEXP psafs_files)
+{
+	std::string graph_name = CHAR(STRING_ELT(pgraph, 0));
+	bool found = false;
+	adj_caches.erase(graph_name);
+
+	auto it = graphs.find(graph_name);
+	if (it != graphs.end()) {
+		// R objects that reference the graph keep it until they're
+		// garbage collected.
+		if (it->second->get_counts() == 1)
+			delete it->second;
+		graphs.erase(it);
+		found = true;
+	}
+
+	// The SAFS files of a graph that isn't in the catalog may belong to
+	// something else, so they're only deleted if the caller asks for it.
+	const graph_entry *entry = catalog->find(graph_name);
+	bool in_safs = entry ? entry->in_safs : LOGICAL(psafs_files)[0];
+	auto graph_files = get_graph_files(graph_name);
+	if (entry) {
+		graph_files.first = entry->adj_file;
+		graph_files.second = entry->index_file;
+	}
+	if (in_safs && !standalone) {
+		safs_file graph_file(get_sys_RAID_conf(), graph_files.first);
+		if (graph_file.exist()) {
+			graph_file.delete_file();
+			found = true;
+		}
+		safs_file index_file(get_sys_RAID_conf(), graph_files.second);
+		if (index_file.exist()) {
+			index_file.delete_file();
+			found = true;
+		}
+	}
+	if (entry) {
+		catalog->remove(graph_name);
+		found = true;
+	}
+
+	if (!found)
+		fprintf(stderr, "graph %s doesn't exist\n", graph_name.c_str());
+	Rcpp::LogicalVector res(1);
+	res[0] = found;
+	return res;
+}
+
+/*
+ * Publish an in-memory graph and attach this process to the published
+ * image, so the process doesn't keep its own copy of the graph.
+ */
+RcppExport SEXP R_FG_publish_graph(SEXP pgraph, SEXP pshm_dir)
+{
+	Rcpp::List graph(pgraph);
+	std::string graph_name = graph["name"];
+	std::string shm_dir = CHAR(STRING_ELT(pshm_dir, 0));
+	Rcpp::LogicalVector res(1);
+	FG_graph::ptr fg = R_FG_get_graph(pgraph);
+	if (fg == NULL || !publish_graph(fg, graph_name, shm_dir)) {
+		res[0] = false;
+		return res;
+	}
+	res[0] = true;
+
+	// The R objects that reference the graph use the image from now on,
+	// and the private copy is freed once no kernel uses it.
+	if (graph.containsElementNamed("pointer")) {
+		FG_graph::ptr shared;
 		try {
-			auto graph_files = get_graph_files(graph_name);
-			FG_graph::ptr fg = FG_graph::create(graph_files.first,
-					graph_files.second, configs);
-			graph_ref *ref = register_in_mem_graph(fg, graph_name);
-			if (ref)
-				return create_FGR_obj(ref);
-			else
-				return create_FGR_obj(fg, graph_name);
-		} catch(wrong_format &e) {
+			shared = attach_graph(graph_name, shm_dir, configs);
+		} catch(std::exception &e) {
 			fprintf(stderr, "%s\n", e.what());
-			return R_NilValue;
 		}
+		graph_ref *ref = (graph_ref *) R_ExternalPtrAddr(graph["pointer"]);
+		if (shared)
+			ref->set_data(shared->get_graph_data(),
+					shared->get_index_data());
 	}
+	return res;
+}
+
+/*
+ * Attach to a graph published by another process and register it
+ * as an in-memory graph.
+ */
+RcppExport SEXP R_FG_attach_graph(SEXP pgraph_name, SEXP pshm_dir)
+{
+	std::string graph_name = CHAR(STRING_ELT(pgraph_name, 0));
+	std::string shm_dir = CHAR(STRING_ELT(pshm_dir, 0));
+	FG_graph::ptr fg;
+	try {
+		fg = attach_graph(graph_name, shm_dir, configs);
+	} catch(std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return R_NilValue;
+	}
+	if (fg == NULL)
+		return R_NilValue;
+
+	graph_ref *ref = register_in_mem_graph(fg, graph_name);
+	if (ref)
+		return create_FGR_obj(ref);
 	else
-		return create_FGR_obj(it->second);
+		return create_FGR_obj(fg, graph_name);
+}
 
+RcppExport SEXP R_FG_unpublish_graph(SEXP pgraph_name, SEXP pshm_dir)
+{
+	std::string graph_name = CHAR(STRING_ELT(pgraph_name, 0));
+	std::string shm_dir = CHAR(STRING_ELT(pshm_dir, 0));
+	Rcpp::LogicalVector res(1);
+	res[0] = unpublish_graph(graph_name, shm_dir);
+	return res;
 }
 
 ///////////////////////////// graph algorithms ///////////////////////////
@@ -661,6 +1261,7 @@ enum R_type
 };
 
 SEXP create_FMR_vector(fm::dense_matrix::ptr m, R_type type, const std::string &name);
+SEXP create_FMR_matrix(fm::dense_matrix::ptr m, R_type type, const std::string &name);
 
 SEXP create_FMR_vector(fm::dense_matrix::ptr m, const std::string &name)
 {
@@ -691,25 +1292,140 @@ fm::dense_matrix::ptr cast_type(fm::vector::ptr vec)
 	return mat->cast_ele_type(fm::get_scalar_type<T>());
 }
 
-RcppExport SEXP R_FG_compute_cc(SEXP graph)
+static std::string get_out_file(SEXP pout_file)
+{
+	if (R_is_null(pout_file))
+		return "";
+	return CHAR(STRING_ELT(pout_file, 0));
+}
+
+/*
+ * Vertex values written to a column file aren't returned to R. We return
+ * the number of values instead.
+ */
+static SEXP get_column_ret(bool success, size_t length)
+{
+	if (!success)
+		return R_NilValue;
+	Rcpp::NumericVector ret(1);
+	ret[0] = length;
+	return ret;
+}
+
+static SEXP write_vertex_column(const std::string &file, fm::vector::ptr vec)
 {
+	return get_column_ret(write_column(file, vec), vec->get_length());
+}
+
+template<class T>
+static SEXP write_vertex_column(const std::string &file,
+		const std::vector<T> &vec)
+{
+	return get_column_ret(write_column(file, vec), vec.size());
+}
+
+RcppExport SEXP R_FG_compute_cc(SEXP graph, SEXP pout_file)
+{
+	std::string out_file = get_out_file(pout_file);
 	FG_graph::ptr fg = R_FG_get_graph(graph);
 	fm::vector::ptr fg_vec = compute_cc(fg);
+	if (!out_file.empty())
+		return write_vertex_column(out_file, fg_vec);
 	return create_FMR_vector(get_vertex_ids(fg_vec), "");
 }
 
-RcppExport SEXP R_FG_compute_wcc(SEXP graph)
+RcppExport SEXP R_FG_compute_wcc(SEXP graph, SEXP pout_file)
 {
+	std::string out_file = get_out_file(pout_file);
 	FG_graph::ptr fg = R_FG_get_graph(graph);
 	fm::vector::ptr fg_vec = compute_wcc(fg);
+	if (!out_file.empty())
+		return write_vertex_column(out_file, fg_vec);
+	return create_FMR_vector(get_vertex_ids(fg_vec), "");
+}
+
+/*
+ * Compute the weakly connected components with a union-find. The component
+ * of a vertex is the smallest vertex in it.
+ */
+RcppExport SEXP R_FG_compute_cc_uf(SEXP graph, SEXP pout_file)
+{
+BEGIN_RCPP
+	std::string out_file = get_out_file(pout_file);
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	component_index::ptr index = component_index::create(fg);
+	if (!out_file.empty())
+		return write_vertex_column(out_file, index->get_membership());
+	fm::vector::ptr fg_vec = create_fm_vector(index->get_membership());
 	return create_FMR_vector(get_vertex_ids(fg_vec), "");
+END_RCPP
+}
+
+static void fg_clean_cc_index(SEXP p)
+{
+	component_index::ptr *index = (component_index::ptr *) R_ExternalPtrAddr(p);
+	delete index;
+}
+
+static component_index::ptr get_cc_index(SEXP pindex)
+{
+	Rcpp::List index(pindex);
+	return *(component_index::ptr *) R_ExternalPtrAddr(index["pointer"]);
 }
 
-RcppExport SEXP R_FG_compute_scc(SEXP graph)
+/*
+ * Create a component index that is kept up to date with inserted edges.
+ */
+RcppExport SEXP R_FG_create_cc_index(SEXP graph)
 {
+BEGIN_RCPP
 	FG_graph::ptr fg = R_FG_get_graph(graph);
+	component_index::ptr *index = new component_index::ptr(
+			component_index::create(fg));
+	Rcpp::List ret;
+	SEXP pointer = R_MakeExternalPtr(index, R_NilValue, R_NilValue);
+	R_RegisterCFinalizerEx(pointer, fg_clean_cc_index, TRUE);
+	ret["pointer"] = pointer;
+	ret["vcount"] = (double) (*index)->get_num_vertices();
+	return ret;
+END_RCPP
+}
+
+RcppExport SEXP R_FG_cc_add_edges(SEXP pindex, SEXP pfrom, SEXP pto)
+{
+BEGIN_RCPP
+	Rcpp::NumericVector Rfrom(pfrom);
+	Rcpp::NumericVector Rto(pto);
+	std::vector<vertex_id_t> from(Rfrom.begin(), Rfrom.end());
+	std::vector<vertex_id_t> to(Rto.begin(), Rto.end());
+	Rcpp::NumericVector ret(1);
+	ret[0] = get_cc_index(pindex)->add_edges(from, to);
+	return ret;
+END_RCPP
+}
+
+RcppExport SEXP R_FG_cc_get_membership(SEXP pindex)
+{
+BEGIN_RCPP
+	component_index::ptr index = get_cc_index(pindex);
+	fm::vector::ptr fg_vec = create_fm_vector(index->get_membership());
+	return create_FMR_vector(get_vertex_ids(fg_vec), "");
+END_RCPP
+}
+
+RcppExport SEXP R_FG_compute_scc(SEXP graph, SEXP pout_file)
+{
+BEGIN_RCPP
+	std::string out_file = get_out_file(pout_file);
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	// SCC runs in libgraph-algs as a single call, so it can only be
+	// interrupted before it starts.
+	check_interrupt();
 	fm::vector::ptr fg_vec = compute_scc(fg);
+	if (!out_file.empty())
+		return write_vertex_column(out_file, fg_vec);
 	return create_FMR_vector(get_vertex_ids(fg_vec), "");
+END_RCPP
 }
 
 RcppExport SEXP R_FG_get_degree(SEXP graph, SEXP ptype)
@@ -733,14 +1449,18 @@ RcppExport SEXP R_FG_get_degree(SEXP graph, SEXP ptype)
 	return create_FMR_vector(get_vertex_ids(fg_vec), "");
 }
 
-RcppExport SEXP R_FG_compute_pagerank(SEXP graph, SEXP piters, SEXP pdamping)
+RcppExport SEXP R_FG_compute_pagerank(SEXP graph, SEXP piters, SEXP pdamping,
+		SEXP pout_file)
 {
 	FG_graph::ptr fg = R_FG_get_graph(graph);
 
 	int num_iters = REAL(piters)[0];
 	float damping_factor = REAL(pdamping)[0];
+	std::string out_file = get_out_file(pout_file);
 
 	fm::vector::ptr fg_vec = compute_pagerank2(fg, num_iters, damping_factor);
+	if (!out_file.empty())
+		return write_vertex_column(out_file, fg_vec);
 	return create_FMR_vector(cast_type<double>(fg_vec), "");
 }
 
@@ -751,6 +1471,39 @@ RcppExport SEXP R_FG_compute_undirected_triangles(SEXP graph)
 	return create_FMR_vector(cast_type<double>(fg_vec), "");
 }
 
+RcppExport SEXP R_FG_count_triangles(SEXP graph, SEXP pmethod, SEXP perror,
+		SEXP pconfidence, SEXP pseed, SEXP pmem_size)
+{
+BEGIN_RCPP
+	std::string method = CHAR(STRING_ELT(pmethod, 0));
+	double error = REAL(perror)[0];
+	double confidence = REAL(pconfidence)[0];
+	unsigned seed = REAL(pseed)[0];
+	size_t mem_size = REAL(pmem_size)[0];
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	if (fg->get_graph_header().is_directed_graph()) {
+		fprintf(stderr, "triangle counting only works on undirected graphs\n");
+		return R_NilValue;
+	}
+
+	triangle_result res;
+	if (method == "exact")
+		res = count_triangles_exact(fg, mem_size);
+	else if (method == "sample")
+		res = count_triangles_sample(fg, error, confidence, seed);
+	else {
+		fprintf(stderr, "unknown method %s\n", method.c_str());
+		return R_NilValue;
+	}
+
+	Rcpp::List ret;
+	ret["triangles"] = Rcpp::NumericVector::create(res.num_triangles);
+	ret["wedges"] = Rcpp::NumericVector::create(res.num_wedges);
+	ret["samples"] = Rcpp::NumericVector::create(res.num_samples);
+	return ret;
+END_RCPP
+}
+
 RcppExport SEXP R_FG_compute_directed_triangles(SEXP graph, SEXP ptype)
 {
 	FG_graph::ptr fg = R_FG_get_graph(graph);
@@ -768,6 +1521,7 @@ RcppExport SEXP R_FG_compute_directed_triangles(SEXP graph, SEXP ptype)
 
 RcppExport SEXP R_FG_compute_local_scan(SEXP graph, SEXP porder)
 {
+BEGIN_RCPP
 	FG_graph::ptr fg = R_FG_get_graph(graph);
 	int order = INTEGER(porder)[0];
 	if (order == 0) {
@@ -778,29 +1532,45 @@ RcppExport SEXP R_FG_compute_local_scan(SEXP graph, SEXP porder)
 		fm::vector::ptr fg_vec = compute_local_scan(fg);
 		return create_FMR_vector(cast_type<double>(fg_vec), "");
 	}
-	else if (order == 2) {
+	else if (order == 2 && fg->get_graph_header().is_directed_graph()) {
 		fm::vector::ptr fg_vec = compute_local_scan2(fg);
 		return create_FMR_vector(cast_type<double>(fg_vec), "");
 	}
+	else if (order >= 2) {
+		fm::vector::ptr fg_vec = compute_local_scan_order(fg, order);
+		return create_FMR_vector(cast_type<double>(fg_vec), "");
+	}
 	else
 		return R_NilValue;
+END_RCPP
 }
 
-RcppExport SEXP R_FG_compute_topK_scan(SEXP graph, SEXP order, SEXP K)
+RcppExport SEXP R_FG_compute_topK_scan(SEXP graph, SEXP porder, SEXP K)
 {
+BEGIN_RCPP
 	size_t topK = REAL(K)[0];
+	int order = REAL(porder)[0];
 	FG_graph::ptr fg = R_FG_get_graph(graph);
-	FG_vector<std::pair<vertex_id_t, size_t> >::ptr fg_vec
-		= compute_topK_scan(fg, topK);
-	assert(fg_vec->get_size() == topK);
-	Rcpp::IntegerVector vertices(fg_vec->get_size());
-	Rcpp::IntegerVector scans(fg_vec->get_size());
-	for (size_t i = 0; i < topK; i++) {
-		std::pair<vertex_id_t, size_t> pair = fg_vec->get(i);
-		vertices[i] = pair.first;
-		scans[i] = pair.second;
+	std::vector<std::pair<vertex_id_t, size_t> > res;
+	// libgraph-algs only computes the top K scan statistics of order 1
+	// on a directed graph.
+	if (order == 1 && fg->get_graph_header().is_directed_graph()) {
+		FG_vector<std::pair<vertex_id_t, size_t> >::ptr fg_vec
+			= compute_topK_scan(fg, topK);
+		assert(fg_vec->get_size() == topK);
+		for (size_t i = 0; i < topK; i++)
+			res.push_back(fg_vec->get(i));
+	}
+	else
+		res = compute_topK_scan_order(fg, order, topK);
+	Rcpp::IntegerVector vertices(res.size());
+	Rcpp::IntegerVector scans(res.size());
+	for (size_t i = 0; i < res.size(); i++) {
+		vertices[i] = res[i].first;
+		scans[i] = res[i].second;
 	}
 	return Rcpp::DataFrame::create(Named("vid", vertices), Named("scan", scans));
+END_RCPP
 }
 
 RcppExport SEXP R_FG_compute_kcore(SEXP graph, SEXP _k, SEXP _kmax)
@@ -812,6 +1582,34 @@ RcppExport SEXP R_FG_compute_kcore(SEXP graph, SEXP _k, SEXP _kmax)
 	return create_FMR_vector(cast_type<double>(fg_vec), "");
 }
 
+RcppExport SEXP R_FG_compute_coreness(SEXP graph, SEXP pout_file)
+{
+BEGIN_RCPP
+	std::string out_file = get_out_file(pout_file);
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	core_result::ptr res = compute_coreness(fg);
+	if (res == NULL)
+		return R_NilValue;
+
+	Rcpp::List ret;
+	if (out_file.empty())
+		ret["coreness"] = create_FMR_vector(cast_type<double>(
+					create_fm_vector(res->cores)), "");
+	else if (write_vertex_column(out_file, res->cores) == R_NilValue)
+		return R_NilValue;
+	Rcpp::NumericVector degeneracy(1);
+	degeneracy[0] = res->degeneracy;
+	ret["degeneracy"] = degeneracy;
+	// Vertex IDs in R are 1-based.
+	std::vector<double> max_core;
+	for (size_t i = 0; i < res->cores.size(); i++)
+		if (res->cores[i] == res->degeneracy)
+			max_core.push_back(i + 1);
+	ret["max.core"] = Rcpp::NumericVector(max_core.begin(), max_core.end());
+	return ret;
+END_RCPP
+}
+
 RcppExport SEXP R_FG_compute_overlap(SEXP graph, SEXP _vids)
 {
 	Rcpp::IntegerVector Rvids(_vids);
@@ -856,14 +1654,108 @@ RcppExport SEXP R_FG_fetch_subgraph(SEXP graph, SEXP pvertices, SEXP pname,
 		return create_FGR_obj(sub_fg, graph_name);
 }
 
-RcppExport SEXP R_FG_estimate_diameter(SEXP graph, SEXP pdirected)
+RcppExport SEXP R_FG_estimate_diameter(SEXP graph, SEXP pdirected,
+		SEXP psweeps, SEXP pseed)
 {
+BEGIN_RCPP
 	FG_graph::ptr fg = R_FG_get_graph(graph);
-	bool directed = INTEGER(pdirected)[0];
-	int diameter = estimate_diameter(fg, 1, directed);
+	bool directed = LOGICAL(pdirected)[0];
+	int num_sweeps = REAL(psweeps)[0];
+	unsigned seed = REAL(pseed)[0];
+	edge_type type = directed ? edge_type::OUT_EDGE : edge_type::BOTH_EDGES;
+	int diameter = estimate_diameter_sweeps(fg, num_sweeps, type, seed);
 	Rcpp::IntegerVector ret(1);
 	ret[0] = diameter;
 	return ret;
+END_RCPP
+}
+
+static bool get_traverse_type(const std::string &mode, edge_type &type)
+{
+	if (mode == "out")
+		type = edge_type::OUT_EDGE;
+	else if (mode == "in")
+		type = edge_type::IN_EDGE;
+	else if (mode == "all")
+		type = edge_type::BOTH_EDGES;
+	else {
+		fprintf(stderr, "wrong traverse mode %s\n", mode.c_str());
+		return false;
+	}
+	return true;
+}
+
+RcppExport SEXP R_FG_compute_bfs(SEXP graph, SEXP psources, SEXP pmode)
+{
+BEGIN_RCPP
+	Rcpp::NumericVector Rsources(psources);
+	std::vector<vertex_id_t> sources(Rsources.begin(), Rsources.end());
+	edge_type type;
+	if (!get_traverse_type(CHAR(STRING_ELT(pmode, 0)), type))
+		return R_NilValue;
+
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	fm::dense_matrix::ptr dists = compute_bfs_dists(fg, sources, type);
+	return create_FMR_matrix(dists, R_type::R_REAL, "");
+END_RCPP
+}
+
+RcppExport SEXP R_FG_estimate_closeness(SEXP graph, SEXP psamples,
+		SEXP pmode, SEXP pharmonic, SEXP pseed)
+{
+BEGIN_RCPP
+	size_t num_samples = REAL(psamples)[0];
+	bool harmonic = LOGICAL(pharmonic)[0];
+	unsigned seed = REAL(pseed)[0];
+	edge_type type;
+	if (!get_traverse_type(CHAR(STRING_ELT(pmode, 0)), type))
+		return R_NilValue;
+
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	fm::vector::ptr fg_vec = estimate_closeness(fg, num_samples, type,
+			harmonic, seed);
+	return create_FMR_vector(cast_type<double>(fg_vec), "");
+END_RCPP
+}
+
+RcppExport SEXP R_FG_compute_sssp(SEXP graph, SEXP psources, SEXP pmode,
+		SEXP pattr_type, SEXP pdelta, SEXP ppreds)
+{
+BEGIN_RCPP
+	Rcpp::NumericVector Rsources(psources);
+	std::vector<vertex_id_t> sources(Rsources.begin(), Rsources.end());
+	std::string attr_type = CHAR(STRING_ELT(pattr_type, 0));
+	double delta = REAL(pdelta)[0];
+	bool get_preds = LOGICAL(ppreds)[0];
+	edge_type type;
+	if (!get_traverse_type(CHAR(STRING_ELT(pmode, 0)), type))
+		return R_NilValue;
+	edge_weight_t weight_type = get_edge_weight_type(attr_type);
+	if (weight_type == edge_weight_t::NONE) {
+		fprintf(stderr, "wrong edge attribute type %s\n", attr_type.c_str());
+		return R_NilValue;
+	}
+
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	sssp_result::ptr res = compute_sssp(fg, sources, type, weight_type, delta,
+			get_preds);
+	if (res == NULL)
+		return R_NilValue;
+
+	Rcpp::List ret;
+	ret["dist"] = create_FMR_vector(cast_type<double>(
+				create_fm_vector(res->dists)), "");
+	if (get_preds) {
+		// Vertex IDs in R are 1-based.
+		std::vector<double> preds(res->preds.size());
+		for (size_t i = 0; i < preds.size(); i++)
+			preds[i] = res->preds[i] == INVALID_VERTEX_ID
+				? NA_REAL : res->preds[i] + 1;
+		ret["pred"] = create_FMR_vector(cast_type<double>(
+					create_fm_vector(preds)), "");
+	}
+	return ret;
+END_RCPP
 }
 
 RcppExport SEXP R_FG_sem_kmeans(SEXP graph, SEXP pk, SEXP pinit,
@@ -888,7 +1780,7 @@ RcppExport SEXP R_FG_sem_kmeans(SEXP graph, SEXP pk, SEXP pinit,
 
     const unsigned NUM_COLS = fg_ret->get_centers()[0].size();
 	Rcpp::NumericMatrix centers = Rcpp::NumericMatrix(k, NUM_COLS);
-#pragma omp parallel for firstprivate(fg_ret) shared(centers)
+	// R objects can only be accessed in the main thread.
 	for (unsigned row = 0; row < k; row++) {
 		for (unsigned col = 0; col < NUM_COLS; col++) {
 			centers(row, col) =  fg_ret->get_centers()[row][col];
@@ -898,14 +1790,308 @@ RcppExport SEXP R_FG_sem_kmeans(SEXP graph, SEXP pk, SEXP pinit,
 	return ret;
 }
 
+RcppExport SEXP R_FG_compute_kmeans(SEXP graph, SEXP pk, SEXP pinit,
+		SEXP pmax_iters, SEXP ptolerance, SEXP pmethod, SEXP pbatch_size,
+		SEXP pattr_type, SEXP pseed)
+{
+BEGIN_RCPP
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	unsigned k = REAL(pk)[0];
+	std::string init = CHAR(STRING_ELT(pinit, 0));
+	unsigned max_iters = REAL(pmax_iters)[0];
+	double tolerance = REAL(ptolerance)[0];
+	std::string method_str = CHAR(STRING_ELT(pmethod, 0));
+	size_t batch_size = REAL(pbatch_size)[0];
+	std::string attr_type = CHAR(STRING_ELT(pattr_type, 0));
+	unsigned seed = REAL(pseed)[0];
+
+	kmeans_method_t method;
+	if (method_str == "pruned")
+		method = kmeans_method_t::PRUNED;
+	else if (method_str == "minibatch")
+		method = kmeans_method_t::MINIBATCH;
+	else {
+		fprintf(stderr, "unknown k-means method: %s\n", method_str.c_str());
+		return R_NilValue;
+	}
+	kmeans_result::ptr res = compute_kmeans(fg, k, init, max_iters,
+			tolerance, method, batch_size, get_edge_weight_type(attr_type),
+			seed);
+	if (res == NULL)
+		return R_NilValue;
+
+	Rcpp::List ret;
+	// Cluster IDs in R are 1-based.
+	std::vector<double> clusters(res->clusters.begin(), res->clusters.end());
+	for (size_t i = 0; i < clusters.size(); i++)
+		clusters[i]++;
+	ret["cluster"] = create_FMR_vector(cast_type<double>(
+				create_fm_vector(clusters)), "");
+	ret["iter"] = res->num_iters;
+	ret["size"] = Rcpp::NumericVector(res->sizes.begin(), res->sizes.end());
+	Rcpp::NumericMatrix centers(k, res->dim);
+	for (unsigned row = 0; row < k; row++)
+		for (size_t col = 0; col < res->dim; col++)
+			centers(row, col) = res->centers[row * res->dim + col];
+	ret["centers"] = centers;
+
+	size_t num_iters = res->stats.size();
+	Rcpp::NumericVector time(num_iters);
+	Rcpp::NumericVector fetched(num_iters);
+	Rcpp::NumericVector pruned(num_iters);
+	Rcpp::NumericVector moved(num_iters);
+	for (size_t i = 0; i < num_iters; i++) {
+		time[i] = res->stats[i].time;
+		fetched[i] = res->stats[i].num_fetched;
+		pruned[i] = res->stats[i].num_pruned;
+		moved[i] = res->stats[i].num_moved;
+	}
+	ret["stats"] = Rcpp::DataFrame::create(Named("time", time),
+			Named("fetched", fetched), Named("pruned", pruned),
+			Named("moved", moved));
+	return ret;
+END_RCPP
+}
+
+RcppExport SEXP R_FG_detect_communities(SEXP graph, SEXP pmethod,
+		SEXP pmax_iters, SEXP pmax_passes, SEXP ptolerance, SEXP presolution,
+		SEXP pattr_type, SEXP pseed)
+{
+BEGIN_RCPP
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	std::string method = CHAR(STRING_ELT(pmethod, 0));
+	unsigned max_iters = REAL(pmax_iters)[0];
+	unsigned max_passes = REAL(pmax_passes)[0];
+	double tolerance = REAL(ptolerance)[0];
+	double resolution = REAL(presolution)[0];
+	std::string attr_type = CHAR(STRING_ELT(pattr_type, 0));
+	unsigned seed = REAL(pseed)[0];
+	edge_weight_t weight_type = get_edge_weight_type(attr_type);
+
+	community_result::ptr res;
+	if (method == "lpa")
+		res = compute_label_propagation(fg, max_iters, weight_type, seed);
+	else if (method == "louvain")
+		res = compute_louvain(fg, max_iters, max_passes, tolerance, resolution,
+				weight_type);
+	else {
+		fprintf(stderr, "unknown community detection method: %s\n",
+				method.c_str());
+		return R_NilValue;
+	}
+
+	Rcpp::List ret;
+	// Community IDs in R are 1-based.
+	std::vector<double> membership(res->membership.begin(),
+			res->membership.end());
+	for (size_t i = 0; i < membership.size(); i++)
+		membership[i]++;
+	ret["membership"] = create_FMR_vector(cast_type<double>(
+				create_fm_vector(membership)), "");
+	ret["modularity"] = res->modularity;
+	ret["num.comms"] = (double) res->num_comms;
+	ret["iter"] = res->num_iters;
+	return ret;
+END_RCPP
+}
+
+RcppExport SEXP R_FG_compute_ego_stats(SEXP graph, SEXP pseeds, SEXP pradius,
+		SEXP pmode, SEXP ptriangles)
+{
+BEGIN_RCPP
+	Rcpp::NumericVector Rseeds(pseeds);
+	std::vector<vertex_id_t> seeds(Rseeds.begin(), Rseeds.end());
+	int radius = REAL(pradius)[0];
+	bool triangles = LOGICAL(ptriangles)[0];
+	edge_type type;
+	if (!get_traverse_type(CHAR(STRING_ELT(pmode, 0)), type))
+		return R_NilValue;
+
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	std::vector<ego_stat> stats = compute_ego_stats(fg, seeds, radius, type,
+			triangles);
+	Rcpp::NumericVector vertices(stats.size());
+	Rcpp::NumericVector edges(stats.size());
+	Rcpp::NumericVector density(stats.size());
+	Rcpp::NumericVector num_triangles(stats.size());
+	Rcpp::NumericVector transitivity(stats.size());
+	for (size_t i = 0; i < stats.size(); i++) {
+		vertices[i] = stats[i].num_vertices;
+		edges[i] = stats[i].num_edges;
+		density[i] = stats[i].density;
+		num_triangles[i] = stats[i].num_triangles;
+		transitivity[i] = stats[i].transitivity;
+	}
+	// Vertex IDs in R start with 1.
+	Rcpp::NumericVector Rvids(Rseeds.size());
+	for (int i = 0; i < Rseeds.size(); i++)
+		Rvids[i] = Rseeds[i] + 1;
+	return Rcpp::DataFrame::create(Named("seed", Rvids),
+			Named("vertices", vertices), Named("edges", edges),
+			Named("density", density), Named("triangles", num_triangles),
+			Named("transitivity", transitivity));
+END_RCPP
+}
+
+/*
+ * Extract the ego-networks of the seeds. An ego-network is returned as
+ * its vertices and a two-column matrix of its edges.
+ */
+RcppExport SEXP R_FG_get_ego_networks(SEXP graph, SEXP pseeds, SEXP pradius,
+		SEXP pmode)
+{
+BEGIN_RCPP
+	Rcpp::NumericVector Rseeds(pseeds);
+	std::vector<vertex_id_t> seeds(Rseeds.begin(), Rseeds.end());
+	int radius = REAL(pradius)[0];
+	edge_type type;
+	if (!get_traverse_type(CHAR(STRING_ELT(pmode, 0)), type))
+		return R_NilValue;
+
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	// R objects can't be created in the worker threads, so the ego-networks
+	// are copied out first.
+	std::vector<std::vector<vertex_id_t> > vertices(seeds.size());
+	std::vector<std::vector<std::pair<vertex_id_t, vertex_id_t> > > edges(
+			seeds.size());
+	for_each_ego_network(fg, seeds, radius, type,
+			[&vertices, &edges](size_t idx, const std::vector<vertex_id_t> &vs,
+				const std::vector<std::pair<vertex_id_t, vertex_id_t> > &es) {
+			vertices[idx] = vs;
+			edges[idx] = es;
+			});
+	Rcpp::List ret(seeds.size());
+	for (size_t i = 0; i < seeds.size(); i++) {
+		// Vertex IDs in R start with 1.
+		Rcpp::NumericVector vs(vertices[i].size());
+		for (size_t j = 0; j < vertices[i].size(); j++)
+			vs[j] = vertices[i][j] + 1;
+		Rcpp::NumericMatrix es(edges[i].size(), 2);
+		for (size_t j = 0; j < edges[i].size(); j++) {
+			es(j, 0) = vertices[i][edges[i][j].first] + 1;
+			es(j, 1) = vertices[i][edges[i][j].second] + 1;
+		}
+		ret[i] = Rcpp::List::create(Named("vertices", vs), Named("edges", es));
+	}
+	return ret;
+END_RCPP
+}
+
+RcppExport SEXP R_FG_random_walks(SEXP graph, SEXP pstarts, SEXP plength,
+		SEXP pnum_walks, SEXP pp, SEXP pq, SEXP pmode, SEXP pseed,
+		SEXP pout_file)
+{
+BEGIN_RCPP
+	Rcpp::NumericVector Rstarts(pstarts);
+	std::vector<vertex_id_t> starts(Rstarts.begin(), Rstarts.end());
+	walk_options opts;
+	opts.length = REAL(plength)[0];
+	opts.walks_per_vertex = REAL(pnum_walks)[0];
+	opts.p = REAL(pp)[0];
+	opts.q = REAL(pq)[0];
+	opts.seed = REAL(pseed)[0];
+	if (!get_traverse_type(CHAR(STRING_ELT(pmode, 0)), opts.type))
+		return R_NilValue;
+	std::string out_file = get_out_file(pout_file);
+
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	size_t num_walks = starts.size() * opts.walks_per_vertex;
+	// The walks are written to the file as 32-bit vertex IDs, a walk in
+	// `length' consecutive IDs.
+	if (!out_file.empty()) {
+		FILE *f = fopen(out_file.c_str(), "w");
+		if (f == NULL) {
+			fprintf(stderr, "can't open %s\n", out_file.c_str());
+			return R_NilValue;
+		}
+		bool success = true;
+		generate_random_walks(fg, starts, opts,
+				[&](const vertex_id_t *walks, size_t num) {
+				size_t len = num * opts.length;
+				if (success && fwrite(walks, sizeof(walks[0]), len, f) != len)
+					success = false;
+				});
+		if (fclose(f) != 0 || !success) {
+			fprintf(stderr, "can't write walks to %s\n", out_file.c_str());
+			return R_NilValue;
+		}
+		Rcpp::NumericVector ret(1);
+		ret[0] = num_walks;
+		return ret;
+	}
+
+	// The dimensions and the cells of an R matrix are indexed with int.
+	if ((double) num_walks * opts.length > std::numeric_limits<int>::max()) {
+		fprintf(stderr, "%ld walks of length %d don't fit in an R matrix\n",
+				num_walks, opts.length);
+		return R_NilValue;
+	}
+	Rcpp::IntegerMatrix ret(num_walks, opts.length);
+	size_t walk = 0;
+	generate_random_walks(fg, starts, opts,
+			[&](const vertex_id_t *walks, size_t num) {
+			for (size_t i = 0; i < num; i++, walk++)
+				for (int j = 0; j < opts.length; j++) {
+					vertex_id_t vid = walks[i * opts.length + j];
+					// Vertex IDs in R start with 1.
+					ret(walk, j) = vid == WALK_END ? NA_INTEGER : vid + 1;
+				}
+			});
+	return ret;
+END_RCPP
+}
+
 RcppExport SEXP R_FG_compute_betweenness(SEXP graph, SEXP _vids)
 {
+BEGIN_RCPP
 	Rcpp::IntegerVector Rvids(_vids);
 	std::vector<vertex_id_t> vids(Rvids.begin(), Rvids.end());
 	FG_graph::ptr fg = R_FG_get_graph(graph);
 
-	fm::vector::ptr fg_vec = compute_betweenness_centrality(fg, vids);
-	return create_FMR_vector(cast_type<double>(fg_vec), "");
+	// Betweenness centrality is the sum of the dependencies of all source
+	// vertices, so we compute it on a chunk of sources at a time to check
+	// for interrupts and take checkpoints between the chunks.
+	const size_t CHUNK_SIZE = 32;
+	fm::dense_matrix::ptr sum;
+	size_t start = 0;
+	checkpointer::ptr ckpter = create_checkpointer();
+	checkpoint::ptr resume = take_resume_checkpoint("betweenness", fg);
+	if (resume) {
+		std::vector<double> sum_vec;
+		if (!resume->get("vids", vids) || !resume->get("sum", sum_vec)) {
+			fprintf(stderr, "the betweenness checkpoint is corrupted\n");
+			return R_NilValue;
+		}
+		start = resume->get_value<size_t>("next");
+		if (!sum_vec.empty())
+			sum = cast_type<double>(create_fm_vector(sum_vec));
+	}
+	for (size_t off = start; off < vids.size(); off += CHUNK_SIZE) {
+		check_interrupt();
+		size_t end = std::min(off + CHUNK_SIZE, vids.size());
+		std::vector<vertex_id_t> chunk(vids.begin() + off, vids.begin() + end);
+		fm::dense_matrix::ptr res = cast_type<double>(
+				compute_betweenness_centrality(fg, chunk));
+		if (sum == NULL)
+			sum = res;
+		else {
+			sum = sum->add(*res);
+			sum->materialize_self();
+		}
+		if (ckpter && ckpter->is_due()) {
+			checkpoint::ptr ckpt = checkpoint::create("betweenness", fg);
+			ckpt->put("vids", vids);
+			ckpt->put("sum", fm::col_vec::create(sum)->conv2std<double>());
+			ckpt->put_value("next", end);
+			ckpter->save(ckpt);
+		}
+	}
+	if (ckpter)
+		ckpter->finish();
+	if (sum == NULL)
+		return R_NilValue;
+	return create_FMR_vector(sum, "");
+END_RCPP
 }
 
 SEXP create_FMR_matrix(fm::sparse_matrix::ptr m, R_type type, const std::string &name);
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include "in_mem_storage.h"
+#include "shm_graph.h"
+
+namespace fg
+{
+
+namespace
+{
+
+const char SHM_GRAPH_MAGIC[8] = {'F', 'G', 'R', 'S', 'H', 'M', '0', '1'};
+
+/*
+ * The header at the beginning of a graph image. The adjacency lists and
+ * the index are aligned to the block size of the filesystem, which is
+ * the huge page size in hugetlbfs.
+ */
+struct shm_graph_header
+{
+	char magic[8];
+	size_t adj_off;
+	size_t adj_size;
+	size_t index_off;
+	size_t index_size;
+};
+
+std::string get_image_file(const std::string &graph_name,
+		const std::string &shm_dir)
+{
+	return shm_dir + "/FlashGraphR-" + graph_name + ".img";
+}
+
+size_t get_block_size(const std::string &dir)
+{
+	struct statfs buf;
+	if (statfs(dir.c_str(), &buf) < 0)
+		return sysconf(_SC_PAGESIZE);
+	return buf.f_bsize;
+}
+
+size_t round_up(size_t size, size_t align)
+{
+	return (size + align - 1) / align * align;
+}
+
+/*
+ * Write the image through a mapping, because files in hugetlbfs can't be
+ * written with write(). The adjacency lists and the index are copied from
+ * memory, where they're stored in the FlashGraph format.
+ */
+bool write_image(const std::string &file, size_t size,
+		const shm_graph_header &header, const char *adj_data,
+		const char *index_data)
+{
+	int fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "can't create %s: %s\n", file.c_str(), strerror(errno));
+		return false;
+	}
+	if (ftruncate(fd, size) < 0) {
+		fprintf(stderr, "can't allocate %ld bytes for %s: %s\n", size,
+				file.c_str(), strerror(errno));
+		close(fd);
+		return false;
+	}
+	char *addr = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		fprintf(stderr, "can't map %s: %s\n", file.c_str(), strerror(errno));
+		return false;
+	}
+	memcpy(addr, &header, sizeof(header));
+	memcpy(addr + header.adj_off, adj_data, header.adj_size);
+	memcpy(addr + header.index_off, index_data, header.index_size);
+	munmap(addr, size);
+	return true;
+}
+
+}
+
+bool publish_graph(FG_graph::ptr fg, const std::string &graph_name,
+		const std::string &shm_dir)
+{
+	if (!fg->is_in_mem()) {
+		fprintf(stderr, "only an in-memory graph can be published\n");
+		return false;
+	}
+
+	// The in-memory graph and index are in the FlashGraph format, which is
+	// what their dump() writes, so they're copied to the image directly.
+	in_mem_graph::ptr graph = fg->get_graph_data();
+	vertex_index::ptr index = fg->get_index_data();
+	size_t adj_size = graph->get_graph_size();
+	size_t index_size = index->get_index_size();
+
+	size_t block_size = get_block_size(shm_dir);
+	shm_graph_header header;
+	memcpy(header.magic, SHM_GRAPH_MAGIC, sizeof(header.magic));
+	header.adj_off = round_up(sizeof(header), block_size);
+	header.adj_size = adj_size;
+	header.index_off = round_up(header.adj_off + adj_size, block_size);
+	header.index_size = index_size;
+	size_t size = round_up(header.index_off + index_size, block_size);
+
+	// Other processes can't see the image until it's complete.
+	std::string file = get_image_file(graph_name, shm_dir);
+	std::string tmp_file = file + ".tmp";
+	bool success = write_image(tmp_file, size, header, graph->get_raw_data(),
+			(const char *) index.get());
+	if (success && rename(tmp_file.c_str(), file.c_str()) < 0) {
+		fprintf(stderr, "can't rename %s: %s\n", tmp_file.c_str(),
+				strerror(errno));
+		success = false;
+	}
+	if (!success)
+		unlink(tmp_file.c_str());
+	return success;
+}
+
+FG_graph::ptr attach_graph(const std::string &graph_name,
+		const std::string &shm_dir, config_map::ptr configs)
+{
+	std::string file = get_image_file(graph_name, shm_dir);
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "can't open the image of graph %s: %s\n",
+				graph_name.c_str(), strerror(errno));
+		return FG_graph::ptr();
+	}
+	struct stat buf;
+	if (fstat(fd, &buf) < 0) {
+		fprintf(stderr, "can't stat %s: %s\n", file.c_str(), strerror(errno));
+		close(fd);
+		return FG_graph::ptr();
+	}
+	size_t size = buf.st_size;
+	char *addr = (char *) mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		fprintf(stderr, "can't map %s: %s\n", file.c_str(), strerror(errno));
+		return FG_graph::ptr();
+	}
+	std::shared_ptr<char> image(addr, [size](char *addr) {
+			munmap(addr, size);
+			});
+
+	shm_graph_header header;
+	if (size < sizeof(header)) {
+		fprintf(stderr, "%s isn't a graph image\n", file.c_str());
+		return FG_graph::ptr();
+	}
+	memcpy(&header, addr, sizeof(header));
+	if (memcmp(header.magic, SHM_GRAPH_MAGIC, sizeof(header.magic)) != 0
+			|| header.adj_off + header.adj_size > size
+			|| header.index_off + header.index_size > size) {
+		fprintf(stderr, "%s isn't a graph image\n", file.c_str());
+		return FG_graph::ptr();
+	}
+
+	// The graph data and the index share the mapping of the image, so
+	// the image is unmapped after both of them are destroyed.
+	std::shared_ptr<char> adj_data(image, addr + header.adj_off);
+	in_mem_graph::ptr graph = in_mem_graph::create(graph_name, adj_data,
+			header.adj_size);
+	vertex_index::ptr index(image, (vertex_index *) (addr + header.index_off));
+	return FG_graph::create(graph, index, graph_name, configs);
+}
+
+bool unpublish_graph(const std::string &graph_name, const std::string &shm_dir)
+{
+	std::string file = get_image_file(graph_name, shm_dir);
+	if (unlink(file.c_str()) < 0) {
+		fprintf(stderr, "can't remove the image of graph %s: %s\n",
+				graph_name.c_str(), strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef __SHM_GRAPH_H__
+#define __SHM_GRAPH_H__
+
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include "FGlib.h"
+
+namespace fg
+{
+
+/*
+ * An in-memory graph can be published to shared memory, so that other
+ * processes on the same machine can attach to it instead of loading their
+ * own copy. A published graph is a single image that contains
+ * the adjacency lists and the index of the graph. The image is a file
+ * named after the graph in `shm_dir', which is /dev/shm for POSIX shared
+ * memory or a mount point of hugetlbfs for huge pages.
+ */
+
+/*
+ * Copy an in-memory graph to an image in `shm_dir'. The caller can attach
+ * to the image afterwards, so it doesn't keep a private copy of the graph.
+ */
+bool publish_graph(FG_graph::ptr fg, const std::string &graph_name,
+		const std::string &shm_dir);
+/*
+ * Map a published graph read-only. The image stays mapped until
+ * the returned graph and all graphs created from it are destroyed.
+ */
+FG_graph::ptr attach_graph(const std::string &graph_name,
+		const std::string &shm_dir, config_map::ptr configs);
+/*
+ * Remove a published graph. The processes that have attached to it
+ * can still use it.
+ */
+bool unpublish_graph(const std::string &graph_name, const std::string &shm_dir);
+
+}
+
+#endif
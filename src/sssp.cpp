@@ -0,0 +1,295 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+typedef std::vector<vertex_id_t> bin_t;
+// Only the non-empty buckets are kept, so a small delta with heavy edges
+// doesn't allocate a bucket for every multiple of delta.
+typedef std::map<size_t, bin_t> bins_t;
+
+/*
+ * Lower the distance of a vertex atomically.
+ * It returns true if the distance is lowered.
+ */
+bool atomic_min(double *addr, double val)
+{
+	union {
+		double d;
+		uint64_t u;
+	} old_val, new_val;
+	new_val.d = val;
+	old_val.d = *addr;
+	while (val < old_val.d) {
+		uint64_t prev = __sync_val_compare_and_swap((uint64_t *) addr,
+				old_val.u, new_val.u);
+		if (prev == old_val.u)
+			return true;
+		old_val.u = prev;
+	}
+	return false;
+}
+
+/*
+ * Each thread puts the vertices whose distances it lowers to its own bins,
+ * so relaxing edges never contends on shared buckets.
+ */
+class relax_visitor: public adj_visitor
+{
+	edge_type type;
+	bool directed;
+	double delta;
+	double *dists;
+	std::vector<bins_t> &local_bins;
+	bool negative;
+public:
+	relax_visitor(edge_type type, bool directed, double delta, double *dists,
+			std::vector<bins_t> &_local_bins): local_bins(
+				_local_bins) {
+		this->type = type;
+		this->directed = directed;
+		this->delta = delta;
+		this->dists = dists;
+		negative = false;
+	}
+
+	bool has_negative() const {
+		return negative;
+	}
+
+	void relax(vertex_id_t vid, const vertex_id_t *neighs,
+			const double *weights, vsize_t num, int thread_id) {
+		double dist = dists[vid];
+		bins_t &bins = local_bins[thread_id];
+		for (vsize_t i = 0; i < num; i++) {
+			if (weights[i] < 0) {
+				negative = true;
+				continue;
+			}
+			double new_dist = dist + weights[i];
+			if (atomic_min(&dists[neighs[i]], new_dist))
+				bins[(size_t) (new_dist / delta)].push_back(neighs[i]);
+		}
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		if (type == edge_type::BOTH_EDGES) {
+			relax(adj.id, adj.out_neighs, adj.out_weights, adj.num_out,
+					thread_id);
+			if (directed)
+				relax(adj.id, adj.in_neighs, adj.in_weights, adj.num_in,
+						thread_id);
+		}
+		else
+			relax(adj.id, adj.get_neighs(type), adj.get_weights(type),
+					adj.get_num_neighs(type), thread_id);
+	}
+};
+
+/*
+ * After the distances converge, the shortest path tree is built with BFS
+ * from the sources over the edges on shortest paths. A vertex takes the
+ * first vertex that reaches it as its predecessor, so the predecessors
+ * can't form cycles even with zero-weight edges.
+ */
+class pred_visitor: public adj_visitor
+{
+	edge_type type;
+	bool directed;
+	const double *dists;
+	const std::vector<bool> &is_source;
+	vertex_id_t *preds;
+	std::vector<bin_t> &next;
+
+	void claim(vertex_id_t vid, const vertex_id_t *neighs,
+			const double *weights, vsize_t num, int thread_id) {
+		for (vsize_t i = 0; i < num; i++) {
+			vertex_id_t u = neighs[i];
+			if (dists[vid] + weights[i] == dists[u] && !is_source[u]
+					&& preds[u] == INVALID_VERTEX_ID
+					&& __sync_bool_compare_and_swap(&preds[u],
+						INVALID_VERTEX_ID, vid))
+				next[thread_id].push_back(u);
+		}
+	}
+public:
+	pred_visitor(edge_type type, bool directed, const double *dists,
+			const std::vector<bool> &_is_source, vertex_id_t *preds,
+			std::vector<bin_t> &_next): is_source(_is_source), next(_next) {
+		this->type = type;
+		this->directed = directed;
+		this->dists = dists;
+		this->preds = preds;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		if (type == edge_type::BOTH_EDGES) {
+			claim(adj.id, adj.out_neighs, adj.out_weights, adj.num_out,
+					thread_id);
+			if (directed)
+				claim(adj.id, adj.in_neighs, adj.in_weights, adj.num_in,
+						thread_id);
+		}
+		else
+			claim(adj.id, adj.get_neighs(type), adj.get_weights(type),
+					adj.get_num_neighs(type), thread_id);
+	}
+};
+
+class weight_stat_visitor: public adj_visitor
+{
+	std::vector<double> sums;
+	std::vector<size_t> counts;
+public:
+	weight_stat_visitor(int num_threads): sums(num_threads), counts(
+			num_threads) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		for (vsize_t i = 0; i < adj.num_out; i++)
+			sums[thread_id] += adj.out_weights[i];
+		counts[thread_id] += adj.num_out;
+	}
+
+	double get_mean() const {
+		double sum = 0;
+		size_t count = 0;
+		for (size_t i = 0; i < sums.size(); i++) {
+			sum += sums[i];
+			count += counts[i];
+		}
+		return count > 0 ? sum / count : 0;
+	}
+};
+
+}
+
+sssp_result::ptr compute_sssp(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type type,
+		edge_weight_t weight_type, double delta, bool get_preds)
+{
+	if (weight_type == edge_weight_t::NONE) {
+		fprintf(stderr, "SSSP requires edge weights\n");
+		return sssp_result::ptr();
+	}
+	adj_scanner::ptr scanner = adj_scanner::create(fg, weight_type);
+	if (!scanner->is_directed())
+		type = edge_type::OUT_EDGE;
+	size_t num_vertices = scanner->get_num_vertices();
+	int num_threads = scanner->get_num_threads();
+	if (delta <= 0) {
+		weight_stat_visitor visitor(num_threads);
+		scanner->scan_all(visitor);
+		delta = visitor.get_mean();
+		// All edges have zero weight.
+		if (delta <= 0)
+			delta = 1;
+	}
+
+	sssp_result::ptr res(new sssp_result());
+	res->dists.resize(num_vertices, std::numeric_limits<double>::infinity());
+	place_vertex_states(res->dists);
+	double *dists = res->dists.data();
+	std::vector<bins_t> local_bins(num_threads);
+	std::vector<bool> is_source(num_vertices);
+	for (size_t i = 0; i < sources.size(); i++) {
+		dists[sources[i]] = 0;
+		is_source[sources[i]] = true;
+		local_bins[0][0].push_back(sources[i]);
+	}
+
+	relax_visitor visitor(type, scanner->is_directed(), delta, dists,
+			local_bins);
+	size_t curr_bin = 0;
+	while (true) {
+		// Find the lowest non-empty bucket among all threads.
+		size_t min_bin = std::numeric_limits<size_t>::max();
+		for (int i = 0; i < num_threads; i++)
+			if (!local_bins[i].empty())
+				min_bin = std::min(min_bin, local_bins[i].begin()->first);
+		if (min_bin == std::numeric_limits<size_t>::max())
+			break;
+		curr_bin = min_bin;
+
+		// Process the bucket until no vertices are added to it. Relaxing
+		// light edges may add vertices to the current bucket again.
+		while (true) {
+			bin_t frontier;
+			for (int i = 0; i < num_threads; i++) {
+				bins_t::iterator it = local_bins[i].find(curr_bin);
+				if (it == local_bins[i].end())
+					continue;
+				frontier.insert(frontier.end(), it->second.begin(),
+						it->second.end());
+				local_bins[i].erase(it);
+			}
+			if (frontier.empty())
+				break;
+			std::sort(frontier.begin(), frontier.end());
+			frontier.erase(std::unique(frontier.begin(), frontier.end()),
+					frontier.end());
+			// A vertex may have moved to a lower bucket after it was
+			// added to this bucket. It has been processed there.
+			size_t num_valid = 0;
+			for (size_t i = 0; i < frontier.size(); i++)
+				if ((size_t) (dists[frontier[i]] / delta) >= curr_bin)
+					frontier[num_valid++] = frontier[i];
+			frontier.resize(num_valid);
+			scanner->scan(frontier, visitor);
+		}
+	}
+	if (visitor.has_negative())
+		fprintf(stderr, "SSSP ignores edges with negative weights\n");
+
+	if (get_preds) {
+		res->preds.resize(num_vertices, INVALID_VERTEX_ID);
+		std::vector<bin_t> next(num_threads);
+		pred_visitor pvisitor(type, scanner->is_directed(), dists, is_source,
+				res->preds.data(), next);
+		bin_t frontier(sources.begin(), sources.end());
+		std::sort(frontier.begin(), frontier.end());
+		frontier.erase(std::unique(frontier.begin(), frontier.end()),
+				frontier.end());
+		while (!frontier.empty()) {
+			scanner->scan(frontier, pvisitor);
+			frontier.clear();
+			for (int i = 0; i < num_threads; i++) {
+				frontier.insert(frontier.end(), next[i].begin(),
+						next[i].end());
+				next[i].clear();
+			}
+			std::sort(frontier.begin(), frontier.end());
+		}
+	}
+	return res;
+}
+
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <queue>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+typedef std::vector<vertex_id_t> vset_t;
+
+/*
+ * A batch has at most SCAN_BATCH_SIZE candidates, and the estimated sizes
+ * of their neighborhoods add up to at most SCAN_BATCH_ENTRIES vertices.
+ * It bounds the memory for the neighborhoods in a batch while a batch
+ * still has enough candidates to amortize the scans of the neighborhoods.
+ */
+const size_t SCAN_BATCH_SIZE = 4096;
+const size_t SCAN_BATCH_ENTRIES = 64 * 1024 * 1024;
+
+/*
+ * Count the edges whose both endpoints are in the neighborhood of
+ * a candidate. In a directed graph, an edge is counted from its source.
+ * In an undirected graph, an edge is counted twice.
+ */
+class count_visitor: public adj_visitor
+{
+	const member_index &index;
+	const std::vector<vset_t> &sets;
+	std::vector<std::vector<size_t> > &local_counts;
+public:
+	count_visitor(const member_index &_index, const std::vector<vset_t> &_sets,
+			std::vector<std::vector<size_t> > &_local_counts): index(_index),
+			sets(_sets), local_counts(_local_counts) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		auto range = index.find(adj.id);
+		for (auto it = range.first; it != range.second; it++) {
+			const vset_t &set = sets[it->second];
+			size_t count = 0;
+			for (vsize_t i = 0; i < adj.num_out; i++)
+				if (std::binary_search(set.begin(), set.end(),
+							adj.out_neighs[i]))
+					count++;
+			local_counts[thread_id][it->second] += count;
+		}
+	}
+};
+
+/*
+ * Compute the scan statistics of the given order on a batch of vertices.
+ */
+std::vector<size_t> compute_scan_batch(adj_scanner::ptr scanner,
+		const std::vector<vertex_id_t> &cands, int order)
+{
+	int num_threads = scanner->get_num_threads();
+	std::vector<vset_t> sets = get_neighborhoods(*scanner, cands, order,
+			edge_type::BOTH_EDGES);
+
+	member_index index(sets);
+	std::vector<std::vector<size_t> > local_counts(num_threads,
+			std::vector<size_t>(cands.size()));
+	count_visitor visitor(index, sets, local_counts);
+	scanner->scan(index.get_vertices(), visitor);
+	std::vector<size_t> scans(cands.size());
+	for (size_t i = 0; i < cands.size(); i++) {
+		for (int j = 0; j < num_threads; j++)
+			scans[i] += local_counts[j][i];
+		if (!scanner->is_directed())
+			scans[i] /= 2;
+	}
+	return scans;
+}
+
+/*
+ * g_{i+1}(v) = g_i(v) + sum of g_i(u) over the neighbors u of v.
+ */
+class bound_visitor: public adj_visitor
+{
+	bool directed;
+	const std::vector<double> &prev;
+	std::vector<double> &next;
+public:
+	bound_visitor(bool directed, const std::vector<double> &_prev,
+			std::vector<double> &_next): prev(_prev), next(_next) {
+		this->directed = directed;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		double sum = prev[adj.id];
+		const std::vector<double> &prev = this->prev;
+		for_each_neigh(adj, edge_type::BOTH_EDGES, directed,
+				[&sum, &prev](vertex_id_t u) {
+				sum += prev[u];
+				});
+		next[adj.id] = sum;
+	}
+};
+
+/*
+ * Each edge in the neighborhood of order k of a vertex is incident to
+ * two vertices in the neighborhood, so the number of edges is at most
+ * half of the total degree of the vertices in the neighborhood. The total
+ * degree is bounded by g_k, which adds up the degrees of the endpoints
+ * of all walks of length at most k from the vertex.
+ */
+std::vector<double> get_scan_bounds(adj_scanner::ptr scanner, int order)
+{
+	std::vector<vsize_t> degrees = scanner->get_degrees(edge_type::BOTH_EDGES);
+	std::vector<double> bounds(degrees.begin(), degrees.end());
+	std::vector<double> next(bounds.size());
+	for (int i = 0; i < order; i++) {
+		bound_visitor visitor(scanner->is_directed(), bounds, next);
+		scanner->scan_all(visitor);
+		bounds.swap(next);
+	}
+	for (size_t i = 0; i < bounds.size(); i++)
+		bounds[i] /= 2;
+	return bounds;
+}
+
+/*
+ * The neighborhood of order k of a vertex has at most 1 + g_{k-1} vertices,
+ * which is at most 1 + twice of the bound of its scan statistic.
+ */
+size_t get_est_size(const std::vector<double> &bounds, vertex_id_t vid)
+{
+	return std::min(1 + 2 * bounds[vid], (double) bounds.size());
+}
+
+/*
+ * Get the end of a batch of candidates that starts at `off'. The candidates
+ * whose bounds don't exceed `min_scan' are left out of the batch.
+ */
+size_t get_batch_end(const std::vector<vertex_id_t> &cands, size_t off,
+		size_t max_size, const std::vector<double> &bounds, double min_scan)
+{
+	size_t end = off;
+	size_t num_entries = 0;
+	while (end < cands.size() && end - off < max_size
+			&& bounds[cands[end]] > min_scan) {
+		num_entries += get_est_size(bounds, cands[end]);
+		// A batch has at least one candidate.
+		if (num_entries > SCAN_BATCH_ENTRIES && end > off)
+			break;
+		end++;
+	}
+	return end;
+}
+
+typedef std::pair<size_t, vertex_id_t> scan_t;
+
+}
+
+std::vector<std::pair<vertex_id_t, size_t> > compute_topK_scan_order(
+		FG_graph::ptr fg, int order, size_t K)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	size_t num_vertices = scanner->get_num_vertices();
+	K = std::min(K, num_vertices);
+	if (K == 0)
+		return std::vector<std::pair<vertex_id_t, size_t> >();
+	// The scan statistic of order 0 is the degree.
+	if (order == 0) {
+		std::vector<vsize_t> degrees = scanner->get_degrees(
+				edge_type::BOTH_EDGES);
+		std::vector<scan_t> scans(num_vertices);
+		for (size_t i = 0; i < num_vertices; i++)
+			scans[i] = scan_t(degrees[i], i);
+		std::partial_sort(scans.begin(), scans.begin() + K, scans.end(),
+				std::greater<scan_t>());
+		std::vector<std::pair<vertex_id_t, size_t> > res(K);
+		for (size_t i = 0; i < K; i++)
+			res[i] = std::pair<vertex_id_t, size_t>(scans[i].second,
+					scans[i].first);
+		return res;
+	}
+
+	std::vector<double> bounds = get_scan_bounds(scanner, order);
+	std::vector<vertex_id_t> order_vids(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		order_vids[i] = i;
+	std::sort(order_vids.begin(), order_vids.end(),
+			[&bounds](vertex_id_t v1, vertex_id_t v2) {
+			return bounds[v1] > bounds[v2];
+			});
+
+	// A min-heap of the largest scan statistics computed so far.
+	std::priority_queue<scan_t, std::vector<scan_t>, std::greater<scan_t> > topK;
+	size_t off = 0;
+	while (off < num_vertices) {
+		// No vertex left can have a larger scan statistic than the K-th
+		// largest one.
+		double min_scan = topK.size() == K ? (double) topK.top().first : -1;
+		if (bounds[order_vids[off]] <= min_scan)
+			break;
+		// When the bounds of the next candidates are close to the K-th
+		// largest scan statistic, most of a large batch may be pruned
+		// after the first few candidates are computed, so the batch
+		// shrinks to a candidate per thread.
+		size_t max_size = SCAN_BATCH_SIZE;
+		if (topK.size() == K && bounds[order_vids[off]] < 2 * min_scan)
+			max_size = scanner->get_num_threads();
+		size_t end = get_batch_end(order_vids, off, max_size, bounds,
+				min_scan);
+		std::vector<vertex_id_t> cands(order_vids.begin() + off,
+				order_vids.begin() + end);
+		std::vector<size_t> scans = compute_scan_batch(scanner, cands, order);
+		for (size_t i = 0; i < cands.size(); i++) {
+			if (topK.size() < K)
+				topK.push(scan_t(scans[i], cands[i]));
+			else if (scans[i] > topK.top().first) {
+				topK.pop();
+				topK.push(scan_t(scans[i], cands[i]));
+			}
+		}
+		off = end;
+	}
+	std::vector<std::pair<vertex_id_t, size_t> > res(topK.size());
+	for (size_t i = res.size(); i > 0; i--) {
+		res[i - 1] = std::pair<vertex_id_t, size_t>(topK.top().second,
+				topK.top().first);
+		topK.pop();
+	}
+	return res;
+}
+
+fm::vector::ptr compute_local_scan_order(FG_graph::ptr fg, int order)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	size_t num_vertices = scanner->get_num_vertices();
+	std::vector<size_t> scans(num_vertices);
+	// The bounds estimate the sizes of the neighborhoods in a batch.
+	std::vector<double> bounds = get_scan_bounds(scanner, order);
+	std::vector<vertex_id_t> vids(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		vids[i] = i;
+	for (size_t off = 0; off < num_vertices; ) {
+		size_t end = get_batch_end(vids, off, SCAN_BATCH_SIZE, bounds, -1);
+		std::vector<vertex_id_t> cands(vids.begin() + off, vids.begin() + end);
+		std::vector<size_t> batch = compute_scan_batch(scanner, cands, order);
+		std::copy(batch.begin(), batch.end(), scans.begin() + off);
+		off = end;
+	}
+	return create_fm_vector(scans);
+}
+
+}
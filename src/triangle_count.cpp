@@ -0,0 +1,535 @@
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <random>
+
+#include "adj_scan.h"
+#include "graph_algs.h"
+
+namespace fg
+{
+
+namespace
+{
+
+/*
+ * Count the common elements of two sorted arrays without duplicates.
+ */
+size_t scalar_intersect(const vertex_id_t *a, size_t na, const vertex_id_t *b,
+		size_t nb)
+{
+	size_t i = 0, j = 0, count = 0;
+	while (i < na && j < nb) {
+		if (a[i] < b[j])
+			i++;
+		else if (a[i] > b[j])
+			j++;
+		else {
+			count++;
+			i++;
+			j++;
+		}
+	}
+	return count;
+}
+
+#ifdef __SSE2__
+/*
+ * Merge-based intersection that compares a block of 4 elements in one array
+ * with a block of 4 elements in the other array in a few SIMD instructions.
+ * A block is advanced if its largest element isn't larger than the largest
+ * element of the other block, the same as the scalar merge.
+ */
+size_t intersect(const vertex_id_t *a, size_t na, const vertex_id_t *b,
+		size_t nb)
+{
+	size_t i = 0, j = 0, count = 0;
+	while (i + 4 <= na && j + 4 <= nb) {
+		__m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i *) (b + j));
+		__m128i cmp = _mm_cmpeq_epi32(va, vb);
+		cmp = _mm_or_si128(cmp, _mm_cmpeq_epi32(va,
+					_mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+		cmp = _mm_or_si128(cmp, _mm_cmpeq_epi32(va,
+					_mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+		cmp = _mm_or_si128(cmp, _mm_cmpeq_epi32(va,
+					_mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+		count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(cmp)));
+		vertex_id_t a_max = a[i + 3];
+		vertex_id_t b_max = b[j + 3];
+		if (a_max <= b_max)
+			i += 4;
+		if (b_max <= a_max)
+			j += 4;
+	}
+	return count + scalar_intersect(a + i, na - i, b + j, nb - j);
+}
+#else
+size_t intersect(const vertex_id_t *a, size_t na, const vertex_id_t *b,
+		size_t nb)
+{
+	return scalar_intersect(a, na, b, nb);
+}
+#endif
+
+/*
+ * The memory of an edge in the oriented adjacency list of a batch vertex
+ * in the exact count: the edge in the list and the request of the other
+ * endpoint.
+ */
+const size_t BATCH_EDGE_BYTES = sizeof(vertex_id_t)
+	+ sizeof(std::pair<vertex_id_t, vertex_id_t>);
+
+/*
+ * The number of wedges sampled in a round, which bounds the memory of
+ * the samples, and the number of wedges sampled in total.
+ */
+const size_t MAX_WEDGE_ROUND = 1UL << 24;
+const size_t MAX_WEDGE_SAMPLES = 1UL << 32;
+
+/*
+ * Vertices are ordered by degree and then by ID. Each edge is kept
+ * only in the oriented adjacency list of its lower-ranked endpoint, so
+ * each triangle is counted exactly once and the adjacency lists of
+ * high-degree vertices stay short.
+ */
+static inline bool lower_rank(const std::vector<vsize_t> &degrees,
+		vertex_id_t u, vertex_id_t v)
+{
+	return degrees[u] < degrees[v] || (degrees[u] == degrees[v] && u < v);
+}
+
+void get_oriented_neighs(const std::vector<vsize_t> &degrees,
+		const adj_list &adj, std::vector<vertex_id_t> &neighs)
+{
+	neighs.clear();
+	for (vsize_t i = 0; i < adj.num_out; i++)
+		if (lower_rank(degrees, adj.id, adj.out_neighs[i]))
+			neighs.push_back(adj.out_neighs[i]);
+	std::sort(neighs.begin(), neighs.end());
+	neighs.erase(std::unique(neighs.begin(), neighs.end()), neighs.end());
+}
+
+/*
+ * Count the edges in the oriented adjacency list of each vertex. The edges
+ * between the same pair of vertices are counted separately, so it's
+ * an upper bound when there are multiple edges.
+ */
+class orient_degree_visitor: public adj_visitor
+{
+	const std::vector<vsize_t> &degrees;
+	std::vector<vsize_t> &odegs;
+public:
+	orient_degree_visitor(const std::vector<vsize_t> &_degrees,
+			std::vector<vsize_t> &_odegs): degrees(_degrees), odegs(_odegs) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		vsize_t count = 0;
+		for (vsize_t i = 0; i < adj.num_out; i++)
+			if (lower_rank(degrees, adj.id, adj.out_neighs[i]))
+				count++;
+		odegs[adj.id] = count;
+	}
+};
+
+/*
+ * Keep the oriented adjacency lists of a batch of vertices.
+ */
+class orient_visitor: public adj_visitor
+{
+	const std::vector<vsize_t> &degrees;
+	const std::vector<vertex_id_t> &batch;
+	std::vector<std::vector<vertex_id_t> > &lists;
+public:
+	orient_visitor(const std::vector<vsize_t> &_degrees,
+			const std::vector<vertex_id_t> &_batch,
+			std::vector<std::vector<vertex_id_t> > &_lists): degrees(_degrees),
+			batch(_batch), lists(_lists) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		size_t idx = std::lower_bound(batch.begin(), batch.end(), adj.id)
+			- batch.begin();
+		get_oriented_neighs(degrees, adj, lists[idx]);
+	}
+};
+
+/*
+ * A vertex in an oriented adjacency list of the batch is requested by
+ * the vertex that owns the list. It intersects its own oriented adjacency
+ * list with the lists of the vertices that request it.
+ */
+class intersect_visitor: public adj_visitor
+{
+	const std::vector<vsize_t> &degrees;
+	const std::vector<std::vector<vertex_id_t> > &lists;
+	// The requests sorted by the requested vertices.
+	const std::vector<std::pair<vertex_id_t, vertex_id_t> > &requests;
+	std::vector<double> &counts;
+	std::vector<std::vector<vertex_id_t> > bufs;
+public:
+	intersect_visitor(const std::vector<vsize_t> &_degrees,
+			const std::vector<std::vector<vertex_id_t> > &_lists,
+			const std::vector<std::pair<vertex_id_t, vertex_id_t> > &_requests,
+			std::vector<double> &_counts): degrees(_degrees), lists(_lists),
+			requests(_requests), counts(_counts), bufs(_counts.size()) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		std::vector<vertex_id_t> &neighs = bufs[thread_id];
+		get_oriented_neighs(degrees, adj, neighs);
+		if (neighs.empty())
+			return;
+		auto it = std::lower_bound(requests.begin(), requests.end(),
+				std::pair<vertex_id_t, vertex_id_t>(adj.id, 0));
+		size_t count = 0;
+		for (; it != requests.end() && it->first == adj.id; it++) {
+			const std::vector<vertex_id_t> &list = lists[it->second];
+			count += intersect(list.data(), list.size(), neighs.data(),
+					neighs.size());
+		}
+		counts[thread_id] += count;
+	}
+};
+
+/*
+ * A wedge is a path of two edges centered at a vertex.
+ */
+struct wedge
+{
+	vertex_id_t center;
+	vertex_id_t end1;
+	vertex_id_t end2;
+	// The location of the wedge in the sequence of samples.
+	uint32_t idx;
+};
+
+/*
+ * Pick the endpoints of the sampled wedges on each center.
+ */
+class wedge_visitor: public adj_visitor
+{
+	std::vector<wedge> &wedges;
+	// The sampled centers and the range of wedges sampled on each center.
+	const std::vector<vertex_id_t> &centers;
+	const std::vector<std::pair<size_t, size_t> > &ranges;
+	unsigned seed;
+public:
+	wedge_visitor(std::vector<wedge> &_wedges,
+			const std::vector<vertex_id_t> &_centers,
+			const std::vector<std::pair<size_t, size_t> > &_ranges,
+			unsigned seed): wedges(_wedges), centers(_centers),
+			ranges(_ranges) {
+		this->seed = seed;
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		std::pair<size_t, size_t> range = ranges[std::lower_bound(
+				centers.begin(), centers.end(), adj.id) - centers.begin()];
+		std::mt19937 gen(seed + adj.id);
+		std::uniform_int_distribution<vsize_t> dist(0, adj.num_out - 1);
+		for (size_t i = range.first; i < range.second; i++) {
+			vsize_t idx1 = dist(gen);
+			vsize_t idx2;
+			do {
+				idx2 = dist(gen);
+			} while (idx2 == idx1);
+			wedges[i].end1 = adj.out_neighs[idx1];
+			wedges[i].end2 = adj.out_neighs[idx2];
+		}
+	}
+};
+
+/*
+ * Check whether the endpoints of the sampled wedges are connected.
+ * The wedges are grouped by their first endpoint.
+ */
+class closure_visitor: public adj_visitor
+{
+	const std::vector<wedge> &wedges;
+	const std::vector<vertex_id_t> &ends;
+	const std::vector<std::pair<size_t, size_t> > &ranges;
+	std::vector<char> &closed;
+	std::vector<std::vector<vertex_id_t> > bufs;
+public:
+	closure_visitor(const std::vector<wedge> &_wedges,
+			const std::vector<vertex_id_t> &_ends,
+			const std::vector<std::pair<size_t, size_t> > &_ranges,
+			std::vector<char> &_closed, int num_threads): wedges(_wedges),
+			ends(_ends), ranges(_ranges), closed(_closed), bufs(num_threads) {
+	}
+
+	void visit(const adj_list &adj, int thread_id) {
+		std::vector<vertex_id_t> &buf = bufs[thread_id];
+		buf.assign(adj.out_neighs, adj.out_neighs + adj.num_out);
+		std::sort(buf.begin(), buf.end());
+		std::pair<size_t, size_t> range = ranges[std::lower_bound(
+				ends.begin(), ends.end(), adj.id) - ends.begin()];
+		for (size_t i = range.first; i < range.second; i++)
+			closed[wedges[i].idx] = std::binary_search(buf.begin(), buf.end(),
+					wedges[i].end2);
+	}
+};
+
+bool wedge_end_less(const wedge &w1, const wedge &w2)
+{
+	return w1.end1 < w2.end1;
+}
+
+/*
+ * Group the sorted items by a vertex. It returns the vertices and
+ * the range of the items of each vertex.
+ */
+template<class T, class GetKey>
+void group_by_vertex(const std::vector<T> &items, GetKey get_key,
+		std::vector<vertex_id_t> &vids,
+		std::vector<std::pair<size_t, size_t> > &ranges)
+{
+	for (size_t i = 0; i < items.size(); ) {
+		size_t j = i + 1;
+		while (j < items.size() && get_key(items[j]) == get_key(items[i]))
+			j++;
+		vids.push_back(get_key(items[i]));
+		ranges.push_back(std::pair<size_t, size_t>(i, j));
+		i = j;
+	}
+}
+
+double count_wedges(const std::vector<vsize_t> &degrees)
+{
+	double num_wedges = 0;
+#pragma omp parallel for reduction(+:num_wedges)
+	for (size_t i = 0; i < degrees.size(); i++)
+		num_wedges += ((double) degrees[i]) * (degrees[i] - 1) / 2;
+	return num_wedges;
+}
+
+/*
+ * Sample wedges uniformly. It returns whether each sampled wedge is closed
+ * in the order of the samples.
+ */
+std::vector<char> sample_wedges(adj_scanner::ptr scanner,
+		std::discrete_distribution<vertex_id_t> &center_dist, size_t num,
+		std::mt19937 &gen)
+{
+	std::vector<wedge> wedges(num);
+	for (size_t i = 0; i < wedges.size(); i++) {
+		wedges[i].center = center_dist(gen);
+		wedges[i].idx = i;
+	}
+	std::sort(wedges.begin(), wedges.end(), [](const wedge &w1,
+				const wedge &w2) {
+			return w1.center < w2.center;
+		});
+
+	// Only the sampled centers are fetched.
+	std::vector<vertex_id_t> centers;
+	std::vector<std::pair<size_t, size_t> > ranges;
+	group_by_vertex(wedges, [](const wedge &w) {
+			return w.center;
+		}, centers, ranges);
+	wedge_visitor wvisitor(wedges, centers, ranges, gen());
+	scanner->scan(centers, wvisitor);
+
+	// Only the first endpoints of the sampled wedges are fetched.
+	std::sort(wedges.begin(), wedges.end(), wedge_end_less);
+	std::vector<vertex_id_t> ends;
+	ranges.clear();
+	group_by_vertex(wedges, [](const wedge &w) {
+			return w.end1;
+		}, ends, ranges);
+	std::vector<char> closed(num);
+	closure_visitor cvisitor(wedges, ends, ranges, closed,
+			scanner->get_num_threads());
+	scanner->scan(ends, cvisitor);
+	return closed;
+}
+
+}
+
+triangle_result count_triangles_exact(FG_graph::ptr fg, size_t mem_size)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	size_t num_vertices = scanner->get_num_vertices();
+	int num_threads = scanner->get_num_threads();
+	std::vector<vsize_t> degrees = scanner->get_degrees(edge_type::OUT_EDGE);
+	std::vector<vsize_t> odegs(num_vertices);
+	orient_degree_visitor dvisitor(degrees, odegs);
+	scanner->scan_all(dvisitor);
+
+	// The highest-ranked vertices are requested by most batches, but their
+	// oriented adjacency lists are short. A quarter of the memory keeps
+	// their lists resident, so their adjacency lists are read only once.
+	std::vector<vertex_id_t> ranked;
+	for (size_t i = 0; i < num_vertices; i++)
+		if (odegs[i] > 0)
+			ranked.push_back(i);
+	std::sort(ranked.begin(), ranked.end(),
+			[&degrees](vertex_id_t u, vertex_id_t v) {
+			return lower_rank(degrees, v, u);
+			});
+	size_t resident_bytes = 0;
+	size_t num_resident = 0;
+	while (num_resident < ranked.size()) {
+		resident_bytes += odegs[ranked[num_resident]] * sizeof(vertex_id_t)
+			+ sizeof(vertex_id_t) + sizeof(std::vector<vertex_id_t>);
+		if (resident_bytes > mem_size / 4)
+			break;
+		num_resident++;
+	}
+	std::vector<vertex_id_t> resident(ranked.begin(),
+			ranked.begin() + num_resident);
+	std::vector<vertex_id_t>().swap(ranked);
+	std::sort(resident.begin(), resident.end());
+	std::vector<std::vector<vertex_id_t> > resident_lists(resident.size());
+	orient_visitor rvisitor(degrees, resident, resident_lists);
+	scanner->scan(resident, rvisitor);
+
+	// Only the oriented adjacency lists of a batch of vertices are kept in
+	// memory. The vertices in the lists are then fetched to intersect their
+	// own oriented adjacency lists with the lists that contain them, unless
+	// their lists are resident. A vertex needs at least two edges in its
+	// oriented list to be the lowest-ranked vertex of a triangle, and
+	// a vertex without edges in its oriented list closes no triangles.
+	size_t max_batch_edges = std::max<size_t>(
+			(mem_size - std::min(mem_size, resident_bytes)) / BATCH_EDGE_BYTES,
+			1);
+	std::vector<double> counts(num_threads);
+	std::vector<vertex_id_t> batch;
+	std::vector<std::vector<vertex_id_t> > lists;
+	std::vector<std::pair<vertex_id_t, vertex_id_t> > requests;
+	size_t batch_edges = 0;
+	for (size_t u = 0; u < num_vertices; u++) {
+		if (odegs[u] > 1) {
+			batch.push_back(u);
+			batch_edges += odegs[u];
+		}
+		if (batch.empty() || (batch_edges < max_batch_edges
+					&& u + 1 < num_vertices))
+			continue;
+
+		lists.resize(batch.size());
+		orient_visitor ovisitor(degrees, batch, lists);
+		scanner->scan(batch, ovisitor);
+		double resident_count = 0;
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 64) \
+		reduction(+:resident_count)
+		for (size_t i = 0; i < lists.size(); i++) {
+			for (size_t j = 0; j < lists[i].size(); j++) {
+				auto it = std::lower_bound(resident.begin(), resident.end(),
+						lists[i][j]);
+				if (it == resident.end() || *it != lists[i][j])
+					continue;
+				const std::vector<vertex_id_t> &rlist
+					= resident_lists[it - resident.begin()];
+				resident_count += intersect(lists[i].data(), lists[i].size(),
+						rlist.data(), rlist.size());
+			}
+		}
+		counts[0] += resident_count;
+		for (size_t i = 0; i < lists.size(); i++)
+			for (size_t j = 0; j < lists[i].size(); j++) {
+				vertex_id_t v = lists[i][j];
+				if (odegs[v] > 0 && !std::binary_search(resident.begin(),
+							resident.end(), v))
+					requests.push_back(std::pair<vertex_id_t, vertex_id_t>(
+								v, i));
+			}
+		std::sort(requests.begin(), requests.end());
+		std::vector<vertex_id_t> vids;
+		for (size_t i = 0; i < requests.size(); i++)
+			if (vids.empty() || vids.back() != requests[i].first)
+				vids.push_back(requests[i].first);
+		intersect_visitor ivisitor(degrees, lists, requests, counts);
+		scanner->scan(vids, ivisitor);
+
+		batch.clear();
+		lists.clear();
+		requests.clear();
+		batch_edges = 0;
+	}
+
+	triangle_result res;
+	res.num_triangles = 0;
+	for (int i = 0; i < num_threads; i++)
+		res.num_triangles += counts[i];
+	res.num_wedges = count_wedges(degrees);
+	res.num_samples = 0;
+	return res;
+}
+
+triangle_result count_triangles_sample(FG_graph::ptr fg, double error,
+		double confidence, unsigned seed)
+{
+	adj_scanner::ptr scanner = adj_scanner::create(fg);
+	size_t num_vertices = scanner->get_num_vertices();
+	std::vector<vsize_t> degrees = scanner->get_degrees(edge_type::OUT_EDGE);
+
+	triangle_result res;
+	res.num_wedges = count_wedges(degrees);
+	res.num_samples = 0;
+	res.num_triangles = 0;
+	if (res.num_wedges == 0)
+		return res;
+
+	// Sample the centers of wedges with the probability proportional to
+	// the number of wedges on them.
+	std::vector<double> weights(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		weights[i] = ((double) degrees[i]) * (degrees[i] - 1) / 2;
+	std::mt19937 gen(seed);
+	std::discrete_distribution<vertex_id_t> center_dist(weights.begin(),
+			weights.end());
+
+	// By the stopping rule of Dagum et al., sampling until `threshold'
+	// closed wedges are found estimates the fraction of closed wedges,
+	// and thus the number of triangles, within a relative error of `error'
+	// with probability `confidence'. Graphs with few closed wedges need
+	// more samples, so the wedges are sampled in rounds.
+	double threshold = 1 + 4 * (M_E - 2) * (1 + error)
+		* log(2 / (1 - confidence)) / (error * error);
+	size_t num_closed = 0;
+	size_t round_size = std::min((size_t) threshold, MAX_WEDGE_ROUND);
+	while (num_closed < threshold && res.num_samples < MAX_WEDGE_SAMPLES) {
+		std::vector<char> closed = sample_wedges(scanner, center_dist,
+				round_size, gen);
+		for (size_t i = 0; i < closed.size() && num_closed < threshold; i++) {
+			res.num_samples++;
+			num_closed += closed[i];
+		}
+		round_size = std::min(round_size * 2, MAX_WEDGE_ROUND);
+	}
+	if (num_closed < threshold)
+		fprintf(stderr, "only %ld closed wedges are found in %ld samples, "
+				"so the relative error may exceed %g\n", num_closed,
+				res.num_samples, error);
+	// Each triangle closes three wedges.
+	res.num_triangles = ((double) num_closed) / res.num_samples
+		* res.num_wedges / 3;
+	return res;
+}
+
+}
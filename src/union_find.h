@@ -0,0 +1,96 @@
+#ifndef __UNION_FIND_H__
+#define __UNION_FIND_H__
+
+/*
+ * Copyright 2017 Open Connectome Project (http://openconnecto.me)
+ *
+ * This file is part of FlashGraphR.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <memory>
+
+#include "FGlib.h"
+
+namespace fg
+{
+
+/*
+ * A lock-free union-find on vertices. Multiple threads can unite and find
+ * concurrently. A root is always linked under a smaller root with CAS, so
+ * the parent pointers never form a cycle and the root of a set is
+ * the smallest vertex in it. find() halves the paths it walks.
+ */
+class concurrent_union_find
+{
+	size_t num_vertices;
+	std::unique_ptr<std::atomic<vertex_id_t>[]> parents;
+public:
+	concurrent_union_find(size_t num_vertices): parents(
+			new std::atomic<vertex_id_t>[num_vertices]) {
+		this->num_vertices = num_vertices;
+		for (size_t i = 0; i < num_vertices; i++)
+			parents[i].store(i, std::memory_order_relaxed);
+	}
+
+	size_t get_num_vertices() const {
+		return num_vertices;
+	}
+
+	vertex_id_t find(vertex_id_t v) {
+		while (true) {
+			vertex_id_t p = parents[v].load(std::memory_order_relaxed);
+			if (p == v)
+				return v;
+			vertex_id_t gp = parents[p].load(std::memory_order_relaxed);
+			if (p != gp)
+				parents[v].compare_exchange_weak(p, gp);
+			v = gp;
+		}
+	}
+
+	/*
+	 * Merge the sets of two vertices. It returns true if they were
+	 * in different sets.
+	 */
+	bool unite(vertex_id_t u, vertex_id_t v) {
+		while (true) {
+			u = find(u);
+			v = find(v);
+			if (u == v)
+				return false;
+			if (u < v)
+				std::swap(u, v);
+			// It fails if `u' is no longer a root.
+			vertex_id_t expected = u;
+			if (parents[u].compare_exchange_strong(expected, v))
+				return true;
+		}
+	}
+
+	/*
+	 * Point every vertex to its root. It can't run concurrently with
+	 * unite().
+	 */
+	void compress() {
+#pragma omp parallel for
+		for (size_t i = 0; i < num_vertices; i++)
+			parents[i].store(find(i), std::memory_order_relaxed);
+	}
+};
+
+}
+
+#endif